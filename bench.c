@@ -0,0 +1,545 @@
+// Benchmark functions
+// Cycle counts of the firmware kernels against their reference versions
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Each benchmark runs the same pseudo-random inputs through the reference
+// (original) code and the optimized kernel, reports the cost per sample from
+// readCpuCycles() and counts the samples where the two disagree. Inputs are
+// generated before timing so only the kernels are measured.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "hal.h"
+#include "uart0.h"
+#include "distance.h"
+#include "library.h"
+#include "fmt.h"
+#include "token.h"
+#include "bench.h"
+
+#define BENCH_BATCH     64          // samples generated and timed at a time
+#define BENCH_E         40
+#define BENCH_D         10
+#define BENCH_LIBRARY_E 10          // QC tolerance for the library queries
+#define BENCH_LARGE_E   65535       // largest E match accepts, e2 near 2^32
+#define BENCH_LINE      (FMT_TRIPLET_MAX + 4) // triplet line with CR LF before and after
+#define BENCH_TOKENS    5           // fields kept per line, as MAX_FIELDS
+#define BENCH_FIELD     20          // the original cmd/arg copy buffers
+
+// The 10k entry library only fits in host memory. BENCH_GRID_BITS is
+// libraryGridBits(BENCH_LIBRARY_MAX), which sizes the cell index.
+#ifdef HOST_SIM
+#define BENCH_LIBRARY_MAX 10000
+#define BENCH_GRID_BITS   4
+#else
+#define BENCH_LIBRARY_MAX 1000
+#define BENCH_GRID_BITS   3
+#endif
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static uint32_t seed;
+
+static const char* const words[] = {"rgb", "off", "calibrate", "linear", "periodic", "match",
+                                    "settle", "adaptive", "bench", "fmt", "output", "binary"};
+static const uint16_t librarySizes[] = {16, 1000, 10000};
+
+// Only one bench subcommand runs at a time, so they share their buffers
+static union
+{
+    struct
+    {
+        uint8_t rgb[BENCH_LIBRARY_MAX][3];
+        uint32_t sorted[BENCH_LIBRARY_MAX];
+        uint16_t id[BENCH_LIBRARY_MAX];
+        uint16_t cellStart[(1 << (3 * BENCH_GRID_BITS)) + 1];
+    } library;
+    struct
+    {
+        char lines[BENCH_BATCH][MAX_CHARS + 1];
+        struct token tokens[BENCH_BATCH][BENCH_TOKENS];
+    } tokens;
+    struct
+    {
+        char reference[BENCH_BATCH][BENCH_LINE];
+        char kernel[BENCH_BATCH][BENCH_LINE];
+    } format;
+} scratch;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static uint32_t benchRandom()
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+static void printCost(const char* name, uint32_t reference, uint32_t kernel, uint16_t samples, uint32_t mismatches)
+{
+    char str[100];
+
+    uint32_t ref10 = (uint64_t)reference * 10 / samples;
+    uint32_t kernel10 = (uint64_t)kernel * 10 / samples;
+
+    sprintf(str, "%s: reference %lu.%lu, kernel %lu.%lu cycles/sample, %lu mismatches\r\n", name,
+            (unsigned long)(ref10 / 10), (unsigned long)(ref10 % 10), (unsigned long)(kernel10 / 10),
+            (unsigned long)(kernel10 % 10), (unsigned long)mismatches);
+    putsUart0(str);
+}
+
+// match against 16 colors and delta on a random walk around them. The delta
+// mismatches against the float model are its accuracy; against the exact
+// integer model there must be none, in the decisions or in the Q16 average at
+// the end of each batch.
+void benchDistance(uint16_t samples)
+{
+    uint32_t colors[16][4];
+    uint16_t rgb[BENCH_BATCH][3];
+    uint16_t refMatch[BENCH_BATCH], intMatch[BENCH_BATCH];
+    bool refDelta[BENCH_BATCH], intDelta[BENCH_BATCH], exactDelta[BENCH_BATCH];
+    uint32_t matchRef = 0, matchInt = 0, deltaRef = 0, deltaInt = 0;
+    uint32_t matchMismatch = 0, deltaMismatch = 0, exactMismatch = 0, averageMismatch = 0;
+    uint32_t e2 = (uint32_t)BENCH_E * BENCH_E;
+    uint32_t start;
+    uint16_t done, n, i;
+    uint8_t c;
+    char str[80];
+
+    seed = 1;
+    for (i = 0; i < 16; i++)
+    {
+        colors[i][0] = 0;
+        for (c = 1; c < 4; c++)
+            colors[i][c] = benchRandom() % 256;
+    }
+    resetDelta();
+    resetDeltaReference();
+    resetDeltaExact();
+    for (done = 0; done < samples; done += n)
+    {
+        n = samples - done < BENCH_BATCH ? samples - done : BENCH_BATCH;
+        for (i = 0; i < n; i++)
+        {
+            // near a library color, so many samples land close to E
+            const uint32_t* near = colors[benchRandom() % 16];
+            for (c = 0; c < 3; c++)
+            {
+                int32_t v = (int32_t)near[c + 1] + (int32_t)(benchRandom() % 61) - 30;
+                rgb[i][c] = v < 0 ? 0 : (v > 255 ? 255 : v);
+            }
+        }
+
+        start = readCpuCycles();
+        for (i = 0; i < n; i++)
+            refMatch[i] = matchColorsReference(rgb[i][0], rgb[i][1], rgb[i][2], colors, 16, BENCH_E);
+        matchRef += readCpuCycles() - start;
+        start = readCpuCycles();
+        for (i = 0; i < n; i++)
+            intMatch[i] = matchColors(rgb[i][0], rgb[i][1], rgb[i][2], colors, 16, e2);
+        matchInt += readCpuCycles() - start;
+
+        start = readCpuCycles();
+        for (i = 0; i < n; i++)
+            refDelta[i] = updateDeltaReference(rgb[i][0], rgb[i][1], rgb[i][2], BENCH_D);
+        deltaRef += readCpuCycles() - start;
+        start = readCpuCycles();
+        for (i = 0; i < n; i++)
+            intDelta[i] = updateDelta(rgb[i][0], rgb[i][1], rgb[i][2], BENCH_D);
+        deltaInt += readCpuCycles() - start;
+        for (i = 0; i < n; i++)
+            exactDelta[i] = updateDeltaExact(rgb[i][0], rgb[i][1], rgb[i][2], BENCH_D);
+
+        for (i = 0; i < n; i++)
+        {
+            matchMismatch += refMatch[i] != intMatch[i];
+            deltaMismatch += refDelta[i] != intDelta[i];
+            exactMismatch += exactDelta[i] != intDelta[i];
+        }
+        averageMismatch += getDeltaAverage() != getDeltaExactAverage();
+    }
+    sprintf(str, "Distance: %u samples, 16 colors, E %u, D %u\r\n", samples, BENCH_E, BENCH_D);
+    putsUart0(str);
+    printCost("match", matchRef, matchInt, samples, matchMismatch);
+    printCost("delta", deltaRef, deltaInt, samples, deltaMismatch);
+    sprintf(str, "delta exact: %lu mismatches, %lu averages, %s\r\n", (unsigned long)exactMismatch,
+            (unsigned long)averageMismatch, exactMismatch == 0 && averageMismatch == 0 ? "pass" : "FAIL");
+    putsUart0(str);
+}
+
+// Sum and xor of the ids, so the two searches can be compared in any order
+static uint32_t idSignature(const uint16_t* ids, uint16_t count)
+{
+    uint32_t sum = 0, x = 0;
+    uint16_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        sum += ids[i];
+        x ^= (uint32_t)ids[i] << (i & 7);
+    }
+    return sum ^ (x << 16) ^ count;
+}
+
+// Grid index against a linear scan for random libraries of 16, 1k and 10k
+void benchLibrary(uint16_t queries)
+{
+    struct library lib;
+    uint16_t gridIds[LIBRARY_REPORT], linearIds[LIBRARY_REPORT];
+    uint16_t gridFound, linearFound;
+    uint32_t e2 = (uint32_t)BENCH_LIBRARY_E * BENCH_LIBRARY_E;
+    uint32_t gridCycles, linearCycles, gridVisited, mismatches, matches;
+    uint32_t start, visited;
+    uint16_t size, q, i;
+    uint16_t rgb[3];
+    uint8_t s, c;
+    char str[160];
+
+    sprintf(str, "Library: %u queries, E %u\r\n", queries, BENCH_LIBRARY_E);
+    putsUart0(str);
+    for (s = 0; s < sizeof(librarySizes) / sizeof(librarySizes[0]); s++)
+    {
+        size = librarySizes[s];
+        if (size > BENCH_LIBRARY_MAX || libraryGridBits(size) > BENCH_GRID_BITS)
+            break;
+        seed = size;
+        for (i = 0; i < size; i++)
+            for (c = 0; c < 3; c++)
+                scratch.library.rgb[i][c] = benchRandom() % 256;
+        lib.gridBits = libraryGridBits(size);
+        libraryBuild((const uint8_t (*)[3])scratch.library.rgb, size, lib.gridBits,
+                     scratch.library.sorted, scratch.library.id, scratch.library.cellStart);
+        lib.rgb = scratch.library.sorted;
+        lib.id = scratch.library.id;
+        lib.cellStart = scratch.library.cellStart;
+        lib.count = size;
+
+        gridCycles = linearCycles = gridVisited = mismatches = matches = 0;
+        for (q = 0; q < queries; q++)
+        {
+            // near a library entry, so queries have matches to find
+            i = benchRandom() % size;
+            for (c = 0; c < 3; c++)
+            {
+                int32_t v = (int32_t)((scratch.library.sorted[i] >> (8 * c)) & 0xFF) + (int32_t)(benchRandom() % 17) - 8;
+                rgb[c] = v < 0 ? 0 : (v > 255 ? 255 : v);
+            }
+            visited = getLibraryVisited();
+            start = readCpuCycles();
+            gridFound = libraryMatch(&lib, rgb[0], rgb[1], rgb[2], e2, gridIds, LIBRARY_REPORT);
+            gridCycles += readCpuCycles() - start;
+            gridVisited += getLibraryVisited() - visited;
+            start = readCpuCycles();
+            linearFound = libraryMatchLinear(&lib, rgb[0], rgb[1], rgb[2], e2, linearIds, LIBRARY_REPORT);
+            linearCycles += readCpuCycles() - start;
+            matches += linearFound;
+            if (gridFound != linearFound || (linearFound <= LIBRARY_REPORT
+                    && idSignature(gridIds, gridFound) != idSignature(linearIds, linearFound)))
+                mismatches++;
+        }
+        sprintf(str, "%5u colors, %2u^3 grid: linear %lu, grid %lu cycles/query, %lu visited/query, %lu matches, %lu mismatches\r\n",
+                size, 1 << lib.gridBits, (unsigned long)(linearCycles / queries), (unsigned long)(gridCycles / queries),
+                (unsigned long)(gridVisited / queries), (unsigned long)matches, (unsigned long)mismatches);
+        putsUart0(str);
+    }
+}
+
+// Byte-per-channel scan as match did it, the baseline for the packed kernels
+static uint16_t scanBytes(const uint8_t (*rgb)[3], uint16_t count, const uint16_t* sample, uint32_t e2)
+{
+    uint16_t found = 0;
+    uint16_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        int32_t dr = (int32_t)sample[0] - rgb[i][0];
+        int32_t dg = (int32_t)sample[1] - rgb[i][1];
+        int32_t db = (int32_t)sample[2] - rgb[i][2];
+        if ((uint32_t)(dr * dr + dg * dg + db * db) < e2)
+            found++;
+    }
+    return found;
+}
+
+// Linear scans of a 1k library within E: bytes, packed C and the packed kernel
+static void benchPackedE(uint16_t queries, uint16_t E)
+{
+    uint16_t size = BENCH_LIBRARY_MAX < 1000 ? BENCH_LIBRARY_MAX : 1000;
+    uint32_t e2 = (uint32_t)E * E;
+    uint32_t byteCycles = 0, cCycles = 0, kernelCycles = 0;
+    uint32_t byteFound, cFound, kernelFound;
+    uint32_t mismatches = 0, matches = 0;
+    uint32_t start, sample;
+    uint16_t hitsC[LIBRARY_REPORT], hitsKernel[LIBRARY_REPORT];
+    uint16_t rgb[3];
+    uint16_t q, i;
+    uint8_t c;
+    char str[140];
+
+    seed = 12;
+    for (i = 0; i < size; i++)
+    {
+        for (c = 0; c < 3; c++)
+            scratch.library.rgb[i][c] = benchRandom() % 256;
+        scratch.library.sorted[i] = PACK_RGB(scratch.library.rgb[i][0], scratch.library.rgb[i][1],
+                                             scratch.library.rgb[i][2]);
+    }
+    for (q = 0; q < queries; q++)
+    {
+        i = benchRandom() % size;
+        for (c = 0; c < 3; c++)
+        {
+            int32_t v = (int32_t)scratch.library.rgb[i][c] + (int32_t)(benchRandom() % 33) - 16;
+            rgb[c] = v < 0 ? 0 : (v > 255 ? 255 : v);
+        }
+        sample = PACK_RGB(rgb[0], rgb[1], rgb[2]);
+
+        start = readCpuCycles();
+        byteFound = scanBytes((const uint8_t (*)[3])scratch.library.rgb, size, rgb, e2);
+        byteCycles += readCpuCycles() - start;
+        start = readCpuCycles();
+        cFound = scanPackedC(scratch.library.sorted, size, sample, e2, hitsC, LIBRARY_REPORT);
+        cCycles += readCpuCycles() - start;
+        start = readCpuCycles();
+        kernelFound = scanPacked(scratch.library.sorted, size, sample, e2, hitsKernel, LIBRARY_REPORT);
+        kernelCycles += readCpuCycles() - start;
+
+        matches += kernelFound;
+        if (byteFound != cFound || cFound != kernelFound
+                || idSignature(hitsC, cFound < LIBRARY_REPORT ? cFound : LIBRARY_REPORT)
+                != idSignature(hitsKernel, kernelFound < LIBRARY_REPORT ? kernelFound : LIBRARY_REPORT))
+            mismatches++;
+    }
+    sprintf(str, "Packed: %u colors, %u queries, E %u, kernel %s\r\n", size, queries, E, getPackedKernel());
+    putsUart0(str);
+    sprintf(str, "bytes %lu, packed c %lu, packed kernel %lu cycles/query, %lu matches, %lu mismatches\r\n",
+            (unsigned long)(byteCycles / queries), (unsigned long)(cCycles / queries),
+            (unsigned long)(kernelCycles / queries), (unsigned long)matches, (unsigned long)mismatches);
+    putsUart0(str);
+}
+
+// The QC tolerance, then an E large enough that every color matches
+void benchPacked(uint16_t queries)
+{
+    benchPackedE(queries, BENCH_LIBRARY_E);
+    benchPackedE(queries, BENCH_LARGE_E);
+}
+
+// periodic output lines, "\r\n(r, g, b)\r\n", with 8-bit and 16-bit values,
+// and the %3u columns of showColors
+void benchFormat(uint16_t samples)
+{
+    uint16_t rgb[BENCH_BATCH][3];
+    char (*reference)[BENCH_LINE] = scratch.format.reference;
+    char (*kernel)[BENCH_LINE] = scratch.format.kernel;
+    uint32_t tripletRef = 0, tripletFmt = 0, paddedRef = 0, paddedFmt = 0;
+    uint32_t tripletMismatch = 0, paddedMismatch = 0;
+    uint32_t start;
+    uint16_t done, batch, i;
+    uint8_t c;
+    char* p;
+
+    seed = 1;
+    for (done = 0; done < samples; done += batch)
+    {
+        batch = samples - done < BENCH_BATCH ? samples - done : BENCH_BATCH;
+        for (i = 0; i < batch; i++)
+            for (c = 0; c < 3; c++)
+                rgb[i][c] = (i & 1) ? benchRandom() & 0xFFFF : benchRandom() & 0xFF;
+
+        start = readCpuCycles();
+        for (i = 0; i < batch; i++)
+            sprintf(reference[i], "\r\n(%u, %u, %u)\r\n", rgb[i][0], rgb[i][1], rgb[i][2]);
+        tripletRef += readCpuCycles() - start;
+        start = readCpuCycles();
+        for (i = 0; i < batch; i++)
+        {
+            p = fmtString(kernel[i], "\r\n");
+            p = fmtTriplet(p, rgb[i][0], rgb[i][1], rgb[i][2]);
+            fmtString(p, "\r\n");
+        }
+        tripletFmt += readCpuCycles() - start;
+        for (i = 0; i < batch; i++)
+            tripletMismatch += strcmp(reference[i], kernel[i]) != 0;
+
+        start = readCpuCycles();
+        for (i = 0; i < batch; i++)
+            sprintf(reference[i], "%3u", rgb[i][0] & 0xFF);
+        paddedRef += readCpuCycles() - start;
+        start = readCpuCycles();
+        for (i = 0; i < batch; i++)
+            fmtPadded(kernel[i], rgb[i][0] & 0xFF, 3, ' ');
+        paddedFmt += readCpuCycles() - start;
+        for (i = 0; i < batch; i++)
+            paddedMismatch += strcmp(reference[i], kernel[i]) != 0;
+    }
+    printCost("triplet", tripletRef, tripletFmt, samples, tripletMismatch);
+    printCost("padded", paddedRef, paddedFmt, samples, paddedMismatch);
+}
+
+static bool isFieldChar(char c)
+{
+    return (c >= '0' && c <= '9') || c == '.' || c == '-' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+// Original tokenizer: field starts and types, then each field copied out and
+// converted (bounded here, the original overran pos[] and the copies)
+static uint8_t referenceTokenize(const char* str, uint8_t* pos, uint8_t* type, uint32_t* value)
+{
+    char field[BENCH_FIELD];
+    uint8_t count = 0, status = 1, i, j;
+
+    for (i = 0; str[i] != 0; i++)
+    {
+        bool alpha = (str[i] >= 'A' && str[i] <= 'Z') || (str[i] >= 'a' && str[i] <= 'z');
+        if (!isFieldChar(str[i]))
+            status = 1;
+        else
+        {
+            if (status == 1 && count < BENCH_TOKENS)
+            {
+                pos[count] = i;
+                type[count++] = alpha ? TOKEN_ALPHA : TOKEN_NUMBER;
+            }
+            status = alpha ? 2 : 3;
+        }
+    }
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; j < BENCH_FIELD - 1 && isFieldChar(str[pos[i] + j]); j++)
+            field[j] = str[pos[i] + j];
+        field[j] = 0;
+        value[i] = type[i] == TOKEN_NUMBER ? strtoul(field, NULL, 10) : 0;
+    }
+    return count;
+}
+
+// Random command-like line, or random bytes for every tenth one
+static void randomLine(char* line)
+{
+    uint8_t length = benchRandom() % (MAX_CHARS + 1);
+    uint8_t i = 0, n;
+
+    if (benchRandom() % 10 == 0)
+    {
+        for (i = 0; i < length; i++)
+            line[i] = 1 + benchRandom() % 255;
+        line[i] = 0;
+        return;
+    }
+    while (i < length)
+    {
+        switch (benchRandom() % 4)
+        {
+        case 0:
+            i = fmtString(&line[i], words[benchRandom() % (sizeof(words) / sizeof(words[0]))]) - line;
+            break;
+        case 1:
+        case 2:
+            for (n = 1 + benchRandom() % 12; n > 0 && i < MAX_CHARS; n--)
+                line[i++] = '0' + benchRandom() % 10;
+            break;
+        default:
+            line[i++] = " ,.-x"[benchRandom() % 5];
+            break;
+        }
+        if (i < MAX_CHARS)
+            line[i++] = ' ';
+    }
+    line[length] = 0;
+}
+
+// True if the tokens cover exactly the fields of line, in order
+static bool isTokenization(const char* line, const struct token* tokens, uint8_t count)
+{
+    uint8_t length = strlen(line), i, j, end = 0;
+
+    for (i = 0; i < count && i < BENCH_TOKENS; i++)
+    {
+        if (tokens[i].length == 0 || tokens[i].offset < end || tokens[i].offset + tokens[i].length > length)
+            return false;
+        for (j = end; j < tokens[i].offset; j++)
+            if (isFieldChar(line[j]))
+                return false;           // a field the lexer skipped
+        for (j = tokens[i].offset; j < tokens[i].offset + tokens[i].length; j++)
+            if (!isFieldChar(line[j]))
+                return false;           // a delimiter inside a field
+        end = tokens[i].offset + tokens[i].length;
+        if (isFieldChar(line[end]))
+            return false;               // field cut short
+    }
+    return true;
+}
+
+// the original tokenizer and copies against tokenize() on random and fuzzed
+// lines; a mismatch is a line where fields, kinds or clean values differ
+void benchTokens(uint16_t samples)
+{
+    char (*lines)[MAX_CHARS + 1] = scratch.tokens.lines;
+    struct token (*tokens)[BENCH_TOKENS] = scratch.tokens.tokens;
+    uint8_t counts[BENCH_BATCH];
+    uint8_t pos[BENCH_TOKENS], type[BENCH_TOKENS];
+    uint32_t value[BENCH_TOKENS];
+    uint32_t reference = 0, kernel = 0, mismatches = 0, invalid = 0, fields = 0, errors = 0;
+    uint32_t start, perSecond;
+    uint16_t done, batch, i;
+    uint8_t count, j;
+    char str[100];
+
+    seed = 1;
+    for (done = 0; done < samples; done += batch)
+    {
+        batch = samples - done < BENCH_BATCH ? samples - done : BENCH_BATCH;
+        for (i = 0; i < batch; i++)
+            randomLine(lines[i]);
+
+        start = readCpuCycles();
+        for (i = 0; i < batch; i++)
+            referenceTokenize(lines[i], pos, type, value);
+        reference += readCpuCycles() - start;
+        start = readCpuCycles();
+        for (i = 0; i < batch; i++)
+            counts[i] = tokenize(lines[i], tokens[i], BENCH_TOKENS);
+        kernel += readCpuCycles() - start;
+
+        for (i = 0; i < batch; i++)
+        {
+            bool same = true;
+            count = referenceTokenize(lines[i], pos, type, value);
+            invalid += !isTokenization(lines[i], tokens[i], counts[i]);
+            same = count == (counts[i] < BENCH_TOKENS ? counts[i] : BENCH_TOKENS);
+            for (j = 0; j < count && same; j++)
+            {
+                same = pos[j] == tokens[i][j].offset && type[j] == tokens[i][j].kind;
+                if (tokens[i][j].kind == TOKEN_NUMBER && tokens[i][j].error == 0)
+                    same = same && value[j] == tokens[i][j].value;
+                errors += tokens[i][j].error != 0;
+            }
+            mismatches += !same;
+            fields += count;
+        }
+    }
+    sprintf(str, "Tokens: %u lines, %lu fields, %lu number errors, %lu invalid\r\n",
+            samples, (unsigned long)fields, (unsigned long)errors, (unsigned long)invalid);
+    putsUart0(str);
+    printCost("tokenize", reference, kernel, samples, mismatches);
+    perSecond = kernel ? (uint64_t)fields * SYSTEM_CLOCK / kernel : 0;
+    sprintf(str, "%lu tokens/s\r\n", (unsigned long)perSecond);
+    putsUart0(str);
+}
@@ -0,0 +1,28 @@
+// Benchmark functions
+// Cycle counts of the firmware kernels against their reference versions
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+
+#define BENCH_SAMPLES   1000        // default samples per benchmark
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void benchDistance(uint16_t samples);
+void benchLibrary(uint16_t queries);
+void benchPacked(uint16_t queries);
+void benchFormat(uint16_t samples);
+void benchTokens(uint16_t samples);
+
+#endif
@@ -29,7 +29,7 @@
 // UART Interface:
 //   U0TX (PA1) and U0RX (PA0) are connected to the 2nd controller
 //   The USB on the 2nd controller enumerates to an ICDI interface and a virtual COM port
-//   Configured to 115,200 baud, 8N1
+//   Configured to 115,200 baud, 8N1; "baud" switches the rate at run time
 
 
 //-----------------------------------------------------------------------------
@@ -40,9 +40,28 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
-#include "tm4c123gh6pm.h"
-#include "wait.h"
+#include <stdlib.h>
 #include <math.h>
+#include "hal.h"
+#include "wait.h"
+#include "uart0.h"
+#include "measure.h"
+#include "sweep.h"
+#include "distance.h"
+#include "library.h"
+#include "colors.h"
+#include "store.h"
+#include "prom.h"
+#include "frame.h"
+#include "stream.h"
+#include "spc.h"
+#include "filter.h"
+#include "profile.h"
+#include "fmt.h"
+#include "token.h"
+#include "command.h"
+#include "script.h"
+#include "bench.h"
 #include "eeprom.h"
 #include "colorimeter.h"
 
@@ -51,421 +70,70 @@
 //-----------------------------------------------------------------------------
 
 
-uint8_t fieldCount=0;              // string_token: number of fields
+uint8_t fieldCount=0;              // fields in the line, tokens[] holds the first MAX_FIELDS
 uint16_t T = 2047;                 // Threshold value (2^n)-1
 uint16_t red = 0;
 uint16_t green = 0;
 uint16_t blue = 0;
 uint16_t E = 0;                    // match E command
 uint16_t D = 0;                    // delta D command
-float iir = 0;
+uint32_t E2 = 0;
 bool matchFlag = false;            // match mode indicator
 bool ledSample = false;            // a flag to tell LED interrupt to flash 
 bool deltaFlag = false;            // delta mode indicator
+bool showActive = false;           // show N waiting for a key
+bool libraryFlag = false;          // match also searches the reference library
+bool binaryFlag = false;           // periodic triplets go out as COBS frames
+bool periodicFlag = false;         // Timer1A is starting measurements
+bool spcFlag = false;              // periodic triplets go into the statistics, not out
+bool commandHashOk = false;        // command slots match the table, checked at boot
+bool recordFlag = false;           // command lines go into a script instead of running
+uint32_t tableSignature = 0;       // commandSignature(), stamped on scripts
+struct script recording;           // script being recorded
+struct script scratchScript;       // script being run or inspected
 
 
-//-----------------------------------------------------------------------------
-// Initialize Hardware
-//-----------------------------------------------------------------------------
-
-void initHw()
-{
-    // Configure HW to work with 16 MHz XTAL, PLL enabled, system clock of 40 MHz
-    // PWM is system clock / 2
-    SYSCTL_RCC_R = SYSCTL_RCC_XTAL_16MHZ | SYSCTL_RCC_OSCSRC_MAIN | SYSCTL_RCC_USESYSDIV | (4 << SYSCTL_RCC_SYSDIV_S)
-                | SYSCTL_RCC_USEPWMDIV | SYSCTL_RCC_PWMDIV_2;
-    // Set GPIO ports to use APB (not needed since default configuration -- for clarity)
-    // Note UART on port A must use APB
-    SYSCTL_GPIOHBCTL_R = 0;
-
-    // Enable clock gating
-    SYSCTL_RCGC2_R = SYSCTL_RCGC2_GPIOA | SYSCTL_RCGC2_GPIOB | SYSCTL_RCGC2_GPIOE;  // GPIO port A, B, E peripherals
-    SYSCTL_RCGC2_R |= SYSCTL_RCGC2_GPIOF;           // enable port f
-    SYSCTL_RCGCUART_R |= SYSCTL_RCGCUART_R0;         // turn-on UART0, leave other uarts in same status
-    SYSCTL_RCGCSSI_R |= SYSCTL_RCGCSSI_R2;          // turn-on SSI2 clocking
-    SYSCTL_RCGC0_R |= SYSCTL_RCGC0_PWM0;            // turn-on PWM0 module
-    SYSCTL_RCGCADC_R |= 1;                          // turn on ADC module 0 clocking
-    SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R1;      // turn on timer 1
-
-    // Configure switch 1, aka push button 1 on port f4
-    GPIO_PORTF_DEN_R |= 0x10;                       // enable bit 16 (1 left-shifted 4)
-    GPIO_PORTF_PUR_R |= 0x10;                       // enable internal pull-up for PB1
-
-    // Configure green LED on board [PF3]
-    GPIO_PORTF_DIR_R |= 1 << 3;     // set bit 3 to output
-    GPIO_PORTF_DR2R_R |= 1 << 3;    // set drive strenth to 2mA (default)
-    GPIO_PORTF_DEN_R |= 1 << 3;     // enable green LED     
-
-    // Configure three backlight LEDs
-    GPIO_PORTB_DIR_R |= 0x20;   // make bit5 an output
-    GPIO_PORTB_DR2R_R |= 0x20;  // set drive strength to 2mA
-    GPIO_PORTB_DEN_R |= 0x20;   // enable bit5 for digital
-    GPIO_PORTB_ODR_R |= 0x20;
-    GPIO_PORTB_AFSEL_R |= 0x20; // select auxilary function for bit 5
-    GPIO_PORTB_PCTL_R = GPIO_PCTL_PB5_M0PWM3; // enable PWM on bit 5
-    GPIO_PORTE_DIR_R |= 0x30;   // make bits 4 and 5 outputs
-    GPIO_PORTE_DR2R_R |= 0x30;  // set drive strength to 2mA
-    GPIO_PORTE_DEN_R |= 0x30;   // enable bits 4 and 5 for digital
-    GPIO_PORTE_ODR_R |= 0x30;
-    GPIO_PORTE_AFSEL_R |= 0x30; // select auxilary function for bits 4 and 5
-    GPIO_PORTE_PCTL_R = GPIO_PCTL_PE4_M0PWM4 | GPIO_PCTL_PE5_M0PWM5; // enable PWM on bits 4 and 5
-
-    // Configure AIN0 as an analog input
-    GPIO_PORTE_AFSEL_R |= 0X08;                     // select alternative functions for AIN0 (PE3)
-    GPIO_PORTE_DEN_R &= ~0X08;                      // turn off digital operation on pin PE3
-    GPIO_PORTE_AMSEL_R |= 0X08;                     // turn on analog operation on pin PE3
-
-    // Configure ADC
-    ADC0_CC_R = ADC_CC_CS_SYSPLL;                  // select PLL as base time (not needed, already default)
-    ADC0_ACTSS_R &= ~ADC_ACTSS_ASEN3;              // disable sample sequencer 3 (SS3) for programming
-    ADC0_EMUX_R = ADC_EMUX_EM3_PROCESSOR;          // select SS3 bit in ADCPSSI as trigger
-    ADC0_SSMUX3_R = 0;                              // set first sample to AIN0
-    ADC0_SSCTL3_R = ADC_SSCTL3_END0;                // mark first sample as the end
-    ADC0_ACTSS_R |= ADC_ACTSS_ASEN3;                 // enable SS3 for operation
-
-    // Configure UART0 pins
-    GPIO_PORTA_DIR_R |= 2;                           // enable output on UART0 TX pin: default, added for clarity
-    GPIO_PORTA_DEN_R |= 3;                           // enable digital on UART0 pins: default, added for clarity
-	GPIO_PORTA_AFSEL_R |= 3;                         // use peripheral to drive PA0, PA1: default, added for clarity
-	GPIO_PORTA_PCTL_R &= 0xFFFFFF00;                 // set fields for PA0 and PA1 to zero
-	GPIO_PORTA_PCTL_R = GPIO_PCTL_PA1_U0TX | GPIO_PCTL_PA0_U0RX;
-                                                     // select UART0 to drive pins PA0 and PA1: default, added for clarity
-
-   	// Configure UART0 to 115200 baud, 8N1 format (must be 3 clocks from clock enable and config writes)
-    UART0_CTL_R = 0;                                 // turn-off UART0 to allow safe programming
-	UART0_CC_R = UART_CC_CS_SYSCLK;                  // use system clock (40 MHz)
-    UART0_IBRD_R = 21;                               // r = 40 MHz / (Nx115.2kHz), set floor(r)=21, where N=16
-    UART0_FBRD_R = 45;                               // round(fract(r)*64)=45
-    UART0_LCRH_R = UART_LCRH_WLEN_8 | UART_LCRH_FEN; // configure for 8N1 w/ 16-level FIFO
-    UART0_CTL_R = UART_CTL_TXE | UART_CTL_RXE | UART_CTL_UARTEN; // enable TX, RX, and module
-
-    // Configure PWM module0 to drive RGB backlight
-    // RED   on M0PWM3 (PB5), M0PWM1b
-    // BLUE  on M0PWM4 (PE4), M0PWM2a
-    // GREEN on M0PWM5 (PE5), M0PWM2b
-    __asm(" NOP");                                   // wait 3 clocks
-    __asm(" NOP");
-    __asm(" NOP");
-    SYSCTL_SRPWM_R = SYSCTL_SRPWM_R0;                // reset PWM0 module
-    SYSCTL_SRPWM_R = 0;                              // leave reset state
-    PWM0_1_CTL_R = 0;                                // turn-off PWM0 generator 1
-    PWM0_2_CTL_R = 0;                                // turn-off PWM0 generator 2
-    PWM0_1_GENB_R = PWM_0_GENB_ACTCMPBD_ZERO | PWM_0_GENB_ACTLOAD_ONE;
-                                                     // output 3 on PWM0, gen 1b, cmpb
-    PWM0_2_GENA_R = PWM_0_GENA_ACTCMPAD_ZERO | PWM_0_GENA_ACTLOAD_ONE;
-                                                     // output 4 on PWM0, gen 2a, cmpa
-    PWM0_2_GENB_R = PWM_0_GENB_ACTCMPBD_ZERO | PWM_0_GENB_ACTLOAD_ONE;
-                                                     // output 5 on PWM0, gen 2b, cmpb
-    PWM0_1_LOAD_R = 1024;                            // set period to 40 MHz sys clock / 2 / 1024 = 19.53125 kHz
-    PWM0_2_LOAD_R = 1024;
-    //PWM0_INVERT_R = PWM_INVERT_PWM3INV | PWM_INVERT_PWM4INV | PWM_INVERT_PWM5INV;
-                                                     // invert outputs for duty cycle increases with increasing compare values
-    PWM0_1_CMPB_R = 0;                               // red off (0=always low, 1023=always high)
-    PWM0_2_CMPB_R = 0;                               // green off
-    PWM0_2_CMPA_R = 0;                               // blue off
-
-    PWM0_1_CTL_R = PWM_0_CTL_ENABLE;                 // turn-on PWM0 generator 1
-    PWM0_2_CTL_R = PWM_0_CTL_ENABLE;                 // turn-on PWM0 generator 2
-    PWM0_ENABLE_R = PWM_ENABLE_PWM3EN | PWM_ENABLE_PWM4EN | PWM_ENABLE_PWM5EN;
-                                                     // enable outputs
-
-    // Configure Timer 1 for periodic interrupt service [periodIsr()]
-    TIMER1_CTL_R &= ~TIMER_CTL_TAEN;                 // turn-off timer before reconfiguring
-    TIMER1_CFG_R = TIMER_CFG_32_BIT_TIMER;           // configure as 32-bit timer (A+B)
-    TIMER1_TAMR_R = TIMER_TAMR_TAMR_PERIOD;          // configure for periodic mode (count down)
-    TIMER1_TAILR_R = 0x30D40;                        // set load value to 2e5 for 200 Hz interrupt rate
-    TIMER1_IMR_R = TIMER_IMR_TATOIM;                 // turn-on interrupts
-    //NVIC_EN0_R |= 1 << (INT_TIMER1A-16);           // turn-on interrupt 37 (TIMER1A)
-    //TIMER1_CTL_R |= TIMER_CTL_TAEN;                // turn-on timer
-}
-
 //-----------------------------------------------------------------------------
 // String/Tokenizing fuctions
 //-----------------------------------------------------------------------------
 
-// Blocking function that writes a serial character when the UART buffer is not full
-void putcUart0(char c)
-{
-	while (UART0_FR_R & UART_FR_TXFF);               // wait if uart0 tx fifo full
-	UART0_DR_R = c;                                  // write character to fifo
-}
-
-// Blocking function that writes a string when the UART buffer is not full
-void putsUart0(char* str)
-{
-	uint8_t i;
-    for (i = 0; str[i] != 0; i++)
-	  putcUart0(str[i]);
-}
-
-// Blocking function that returns with serial data once the buffer is not empty
-char getcUart0()
-{
-	while (UART0_FR_R & UART_FR_RXFE);               // wait if uart0 rx fifo empty
-	return UART0_DR_R & 0xFF;                        // get character from fifo
-}
-
-void getsUart0(char* str)
-{
-    uint8_t counter = 0;                             // also index for string
-    char c;
-
-    while(true)
-    {
-        c = getcUart0();
-        if (c == 8)                                 // if c = backspace
-        {
-            if(counter == 0)                        // if string is already empty
-                counter = 0;                        // set index to 0
-            else
-                --counter;                          // decrement counter
-        }
-        else if(c == 13)                            // if c = enter key
-        {
-            str[counter++] = '\0';                  // null terminate
-            getcUart0();                            // get remaining line feed char from remaining Uart0 buffer
-            return;
-        }
-        else
-        {
-            if (c >= 65  && c <= 90)                // if upper case letter
-                c += 32;                            // convert to lower case letter
-
-            str[counter] = c;                       // place character into string
-            counter++;                              // increment counter
-            if (counter == (MAX_CHARS - 1))         // if max input is reached
-            {
-                str[counter++] = '\0';              // null terminate
-                return;
-            }
-        }
-    }
-}
-
-bool isChar(const char c)
+// true if field n is the word text, compared in place
+bool isArg(uint8_t n, const char* text)
 {
-    if((c >= 'A' && c <='Z') || (c >= 'a' && c <= 'z'))
-        return true;
-    else
-        return false;
+    return n < fieldCount && n < MAX_FIELDS && isTokenText(strInput, &tokens[n], text);
 }
 
-bool isNum(const char c)
+// numeric field n, saturated at 65535 so the handlers' range checks see
+// values that do not fit 16 bits as too big
+uint16_t getValue(uint8_t n)
 {
-    if (c >= 48 && c <= 57)     // ascii values for numbers 0-9
-        return true;
-    else if(c == '.' || c == '-')
-        return true;
-    else
-        return false;
+    uint32_t value = getLongValue(n);
+    return value > 0xFFFF ? 0xFFFF : value;
 }
 
-bool isDelimit(const char c)
+// numeric field n, for values that need more than 16 bits
+uint32_t getLongValue(uint8_t n)
 {
-    bool result = true;
-    if(isNum(c))
-        result = false;
-    if(isChar(c))
-        result = false;
-    return result;
+    return tokens[n].value;
 }
 
-void tokenizeStr()
+// true if every numeric argument parsed, otherwise says which one did not
+bool checkNumbers()
 {
-    uint8_t i=0;            			// string index
-    uint8_t j=0;            			// position index
-    uint8_t status=0;       			// 0=reset, 1=delimiter, 2=alpha, 3=numeric
-    fieldCount = 0;
+    uint8_t i;
+    char str[60];
 
-    // finding positions and number of fields
-    for(i=0; strInput[i] != 0; i++)
+    for(i = 1; i < fieldCount && i < MAX_FIELDS; i++)
     {
-        if(i==0)                        // evaluate first character
-        {
-            if(isDelimit(strInput[i]))  // if char is delimiter
-            {
-                status = 1;             // change status to delimiter
-            }
-            else
-            {
-                pos[j++] = i;           // update starting field index
-                ++fieldCount;           // increment field count
-
-                if(isChar(strInput[i])) // if char is alphabet  
-                    status = 2;         // update status to alphabet
-                else                    // if number                      
-                    status = 3;         // update status to numeric
-            }
-        }
-        else
+        if(tokens[i].kind == TOKEN_NUMBER && tokens[i].error != 0)
         {
-            if(isDelimit(strInput[i]))
-            {
-                status = 1;
-            }
-            else if(isChar(strInput[i]))
-            {
-                if(status==1)           // if previous char was delimiter
-                {
-                    pos[j++] = i;       // update starting field position
-                    ++fieldCount;       // increment field count
-                }
-                status = 2;
-            }
-            else if(isNum(strInput[i]))
-            {
-                if (status==1)          // if previous char was delimiter
-                {
-                    pos[j++] = i;       // update starting field position
-                    ++fieldCount;       // increment field count
-                }
-                status = 3;
-            }
+            sprintf(str, "\r\nStatus: argument %u %s\r\n", i,
+                    tokens[i].error & TOKEN_RANGE ? "is out of range" : "is not a whole number");
+            putsUart0(str);
+            return false;
         }
     }
-
-    // determine field types
-    for(i=0; i<fieldCount; i++)
-    {
-        if(isNum(strInput[pos[i]]))
-            type[i] = 2;
-        else
-            type[i] = 1;
-    }
-}
-
-
-// Gets command from first field
-void parseCmd(uint8_t n)
-{
-    uint8_t index=0;
-    uint8_t i;
-
-    for(i=pos[n]; !isDelimit(strInput[i]); i++)
-    {
-        cmd[index++] = strInput[i];
-    }
-    cmd[index] = '\0';     				// null terminate string
-}
-
-// gets argument at specific position
-void parseArg(uint8_t n)
-{
-    uint8_t i, index=0;
-
-    for(i=pos[n]; !isDelimit(strInput[i]); i++)
-    {
-        arg[index++] = strInput[i];
-    }
-    arg[index] = '\0';
-}
-
-// n is used as the element number in position array
-uint16_t getValue(uint8_t n)
-{
-    uint8_t i;
-    uint8_t j=0;                		// temp index
-    uint16_t result;	
-    char temp[4];               		// to store rgb text values
-    
-    // get red value
-    for(i=pos[n]; !isDelimit(strInput[i]); i++)
-    {
-        temp[j++] = strInput[i];
-    }
-    temp[j] = '\0';
-    result = atoi(temp);
-    return result;
-}
-
-bool isCommand(const char* str)
-{
-    bool result = false;
-    
-    if(strcmp(str, "help") == 0 || strcmp(str, "menu") == 0)
-    {
-        // help command has no args
-        if(strcmp(str,cmd) == 0 && fieldCount == 1)
-            result = true;
-    }
-    else if(strcmp(str, "rgb") == 0)
-    {
-        // rgb command with three number args
-        if(strcmp(str,cmd) == 0 && fieldCount == 4)
-            result = true;
-        // if rgb off command    
-        else if(strcmp(str,cmd) == 0 && fieldCount == 2)
-            result = true;
-    }
-    else if(strcmp(str, "light") == 0)
-    {
-        // if light command and no arg
-        if(strcmp(str, cmd) == 0 && fieldCount == 1)
-            result = true;
-    }
-    else if(strcmp(str, "ramp") == 0)
-    {
-        // if ramp command with second arg being a color name
-       if(strcmp(str, cmd) == 0 && fieldCount == 4 && type[1] == 1 && type[2] == 1 && type[3] == 1)
-            result = true;
-    }
-    else if(strcmp(str, "test") == 0)
-    {
-        if(strcmp(str, cmd) == 0 && fieldCount == 1)
-            result = true;        
-    }
-    else if(strcmp(str, "calibrate") == 0)
-    {
-        if(strcmp(str, cmd) == 0 && fieldCount == 1)
-            result = true;
-    }
-    else if(strcmp(str, "trigger") == 0)
-    {
-        if(strcmp(str, cmd) == 0 && fieldCount == 1)
-            result = true;
-    }
-    else if(strcmp(str, "button") == 0)
-    {
-        if(strcmp(str, cmd) == 0 && fieldCount == 1)
-            result = true;
-    }
-    else if(strcmp(str, "periodic") == 0)
-    {
-        if(strcmp(str, cmd) == 0 && fieldCount == 2)
-            result = true;
-    }
-    else if(strcmp(str, "led") == 0)
-    {
-        if(strcmp(str, cmd) == 0 && fieldCount == 2)
-            result = true;
-    }
-    else if(strcmp(str, "color") == 0)
-    {
-        if(strcmp(str, cmd) == 0 && fieldCount == 2 && type[1] == 2)
-            result = true;
-    }
-    else if(strcmp(str, "show") == 0)
-    {
-        if(strcmp(str, cmd) == 0 && fieldCount == 2 && type[1] == 2)
-            result = true;
-    }
-    else if(strcmp(str, "erase") == 0)
-    {
-        if(strcmp(str, cmd) == 0 && fieldCount == 2 && type[1] == 2)
-            result = true;
-    }
-    else if(strcmp(str, "match") == 0)
-    {
-        if(strcmp(str, cmd) == 0 && fieldCount == 2 && type[1] == 2)
-            result = true;
-    }
-     else if(strcmp(str, "delta") == 0)
-    {
-        if(strcmp(str, cmd) == 0 && fieldCount == 2)
-            result = true;
-    }
-
-    return result;
+    return true;
 }
 
 //-----------------------------------------------------------------------------
@@ -478,83 +146,73 @@ void promMenu()
     putsUart0("=================================================================================\r\n");
     putsUart0("                               EEPROM MENU\r\n");
     putsUart0("=================================================================================\r\n");
-    putsUart0("promCalibration      - shows calibrated rgb values\r\n");
-    putsUart0("promShowColors       - lists valid colors in EEPROM\r\n");
-    putsUart0("promErase            - erases EEPROM to factory default\r\n");
-}
-
-// Initialize EEPROM
-uint16_t enableEeprom()
-{
-    SYSCTL_RCGCEEPROM_R = 0x01;
-    uint16_t status = EEPROMInit();
-    while(status != EEPROM_INIT_OK)
-    {
-        status = EEPROMInit();
-    }
-    return status;
-}
-
-void saveColorToProm()
-{
-    uint32_t result = EEPROMProgram(colors, 0x0, sizeof(colors));
-    if (result != 0)
-        putsUart0("Status: failed to save color to EEPROM\r\n");
+    listCommands(COMMAND_PROM, "%-20s - %s\r\n");
 }
 
 void saveCalibrationToProm()
 {
-    uint32_t result = EEPROMProgram(calibration, 0x400, sizeof(calibration));
-    if (result != 0)
-        putsUart0("Status: failed to save to calibration EEPROM\r\n");   
+    // learned settle times are saved with the calibration, in the slot not in use
+    if(!saveCalibration(calibration, settleTimes))
+        putsUart0("Status: failed to save calibration to EEPROM\r\n");
 }
 
+// reads the layout header and calibration slots; colors are loaded on first use
 void readFromProm()
 {
     char str[60];
-    uint8_t i, colorCount=0;
-
-    // read colors at address 0x0
-    EEPROMRead(promColors, 0x0, sizeof(promColors));
-    memcpy(colors, promColors, sizeof(promColors));
-
-    // read calibration at address 0x400 (address/32blocks = block 32, 0 offset)
-    EEPROMRead(promCalibration, 0x400, sizeof(promCalibration));
-    memcpy(calibration, promCalibration, sizeof(calibration));
+    uint16_t records;
+    uint8_t state;
+    bool migrated;
 
-    // if values read all ones, then default from EEPROM and nothing written
-    if(calibration[0] == 0xFFFFFFFF && calibration[1] == 0xFFFFFFFF & calibration[2] == 0xFFFFFFFF)
+    state = openProm();
+    if(state == PROM_NEWER)
     {
-        calibration[0] = 0;
-        calibration[1] = 0;
-        calibration[2] = 0;
+        putsUart0("Status: EEPROM layout is newer than this firmware, not restored\r\n");
+        return;
     }
-
-    if(calibration[0] == 0 && calibration[1] == 0 && calibration[2] == 0)
+    if(state == PROM_MIGRATED)
+        putsUart0("Status: calibration moved to the versioned layout\r\n");
+    else if(state == PROM_UPGRADED)
+        putsUart0("Status: EEPROM layout upgraded, scripts section added\r\n");
+    else if(state == PROM_FORMATTED)
+        putsUart0("Status: EEPROM layout written\r\n");
+
+    // color records at address 0x0, converting older images
+    records = openColors(&migrated);
+    if(migrated)
+        putsUart0("Status: color library converted to the record store\r\n");
+
+    if(getPromCrcErrors() != 0)
+        putsUart0("Status: calibration slot failed its CRC, using the other one\r\n");
+    if(!loadCalibration(calibration, settleTimes))
     {
+        calibration[0] = calibration[1] = calibration[2] = 0;
         putsUart0("Status: not yet calibrated\r\n");
     }
     else
     {
+        if(settleTimes[0] != 0)
+            setLearnedSettle(settleTimes);
         sprintf(str, "Status: Calibration restored; (%u, %u, %u)\r\n", calibration[0], calibration[1], calibration[2]);
         putsUart0(str);
     }
 
-    for(i=0; i<16; i++)
-    {
-        if(colors[i][0] == 0)
-        {
-            colorCount++;
-        }
-    }
-    sprintf(str, "Status: restored %u colors.\r\n", colorCount);
+    if(areColorsLoaded())
+        sprintf(str, "Status: restored %u colors.\r\n", countColors());
+    else
+        sprintf(str, "Status: %u color records, loaded on first use\r\n", records);
     putsUart0(str);
 }
 
 void promErase()
 {
     char str[40] = "";
-    uint32_t result = EEPROMMassErase();
+    uint32_t result;
+
+    loadColors();                       // colors survive the erase in RAM
+    result = EEPROMMassErase();
+    resetColorStore();
+    openProm();                         // header again, calibration stays in RAM
     if(result == 0)
         putsUart0("Status: EEPROM erased\r\n");
     else
@@ -564,16 +222,16 @@ void promErase()
 
 void promShowColors()
 {
-    EEPROMRead(promColors, 0x0, sizeof(promColors));
     uint8_t i;
+    uint8_t r, g, b;
     char str[40];
     uint8_t colorCount = 0;
-    for(i=0; i<16; i = i + 1)
+    for(i=0; i<COLOR_SLOTS; i = i + 1)
     {
-        if(promColors[i][0] == 0)
+        if(readPromColor(i, &r, &g, &b))
         {
             colorCount++;
-            sprintf(str, "Color %2u: (%3u, %3u, %3u)\r\n", i, promColors[i][1], promColors[i][2], promColors[i][3]);
+            sprintf(str, "Color %2u: (%3u, %3u, %3u)\r\n", i, r, g, b);
             putsUart0(str);
         }
     }
@@ -582,43 +240,61 @@ void promShowColors()
         putsUart0("Status: no colors saved\r\n");
 }
 
-void promShowCalibration()
+// shows where the color records are and what saving them has cost
+void promStore()
 {
-    EEPROMRead((uint32_t*)&promCalibration, 0x400, sizeof(promCalibration));
-    char str[40];
+    char str[100];
+    uint8_t i;
 
-    if(promCalibration[0] == 0xFFFFFFFF && promCalibration[1] == 0xFFFFFFFF && promCalibration[2] == 0xFFFFFFFF)
+    if(isStoreFormatted())
+        sprintf(str, "Store: segment %u, sequence %u, %u/%u records, %u colors\r\n", getStoreSegment(),
+                getStoreSequence(), getStoreRecords(), STORE_SEGMENT_WORDS - 1, countColors());
+    else
+        sprintf(str, "Store: empty, %u colors\r\n", countColors());
+    putsUart0(str);
+    sprintf(str, "Saves: %u, %u compactions, %u words left to blank\r\n", getStoreAppends(),
+            getStoreCompactions(), getStoreErasePending());
+    putsUart0(str);
+    for(i = 0; i < STORE_SEGMENTS; i++)
     {
-        putsUart0("Status: no calibration saved in EEPROM\r\n");
+        sprintf(str, "Segment %u: %u word writes\r\n", i, getStoreWrites(i));
+        putsUart0(str);
     }
-    else
+    sprintf(str, "Save latency: %u us last, %u us average, %u us max\r\n", getStoreLastLatency(),
+            getStoreAverageLatency(), getStoreMaxLatency());
+    putsUart0(str);
+}
+
+// shows both calibration slots and which one is in use
+void promShowCalibration()
+{
+    const char* states[] = {"empty", "valid", "CRC error"};
+    uint32_t pwm[3], settle[3], sequence;
+    uint8_t n, state;
+    char str[100];
+
+    for(n = 0; n < 2; n++)
     {
-        sprintf(str, "Calibration: (%u, %u, %u)\r\n", promCalibration[0], promCalibration[1], promCalibration[2]);
+        state = readCalibrationSlot(n, pwm, settle, &sequence);
+        if(state == SLOT_EMPTY)
+            sprintf(str, "Slot %c: empty\r\n", 'A' + n);
+        else
+            sprintf(str, "Slot %c: %s, sequence %u, (%u, %u, %u), settle (%u, %u, %u) us%s\r\n", 'A' + n,
+                    states[state], sequence, pwm[0], pwm[1], pwm[2], settle[0], settle[1], settle[2],
+                    getCalibrationSlot() == n ? ", in use" : "");
         putsUart0(str);
-    }   
+    }
+    if(getCalibrationSlot() > 1)
+        putsUart0("Status: no calibration saved in EEPROM\r\n");
 }
 
 //-----------------------------------------------------------------------------
 // Utility functions
 //-----------------------------------------------------------------------------
 
-void setRgbColor(uint16_t red, uint16_t green, uint16_t blue)
-{
-    PWM0_1_CMPB_R = red;
-    PWM0_2_CMPA_R = blue;
-    PWM0_2_CMPB_R = green;
-}
-
-uint16_t readAdc0Ss3()
-{
-    ADC0_PSSI_R |= ADC_PSSI_SS3;                    // set start bit
-    while(ADC0_ACTSS_R & ADC_ACTSS_BUSY);           // wait until SS3 is not busy
-    return ADC0_SSFIFO3_R;                          // get single result from the FIFO
-}
-
 void waitPb1()
 {
-    while(PUSH_BUTTON1);
+    while(!isPb1Pressed());
 }
 
 bool notCalibrated()
@@ -635,26 +311,29 @@ bool notCalibrated()
 // Command functions
 //-----------------------------------------------------------------------------
 
+// lists the commands of one menu from the command table, usage then help
+void listCommands(uint8_t menu, const char* format)
+{
+    uint8_t i;
+    char str[120];
+
+    for(i=0; i<commandTable.count; i++)
+    {
+        if(commandTable.commands[i].menu == menu)
+        {
+            snprintf(str, sizeof(str), format, commandTable.commands[i].usage, commandTable.commands[i].help);
+            putsUart0(str);
+        }
+    }
+}
+
 void showMenu()
 {
     putsUart0("\r\n");
     putsUart0("=================================================================================\r\n");
     putsUart0("                               MAIN MENU\r\n");
     putsUart0("=================================================================================\r\n");
-    putsUart0("rgb [#] [#] [#]              (changes rgb to specified value)\r\n");
-    putsUart0("rgb off                      (turns off all rgb)\r\n");
-    putsUart0("light                        (measures light intensity)\r\n");
-    putsUart0("ramp red|green|blue          (ramps up each rgb)\r\n");
-    putsUart0("test                         (ramps and measures all rgb values)\r\n");
-    putsUart0("calibrate                    (gets redPwm, greenPwm, and bluePwm values))\r\n");
-    putsUart0("trigger                      (turns on led light calibrated rgb and displays R values)\r\n");
-    putsUart0("button                       (uses SW1 to perform trigger function)\r\n");
-    putsUart0("led x                        (x = on, off, or sample)\r\n");
-    putsUart0("periodic T                   (T = 0 - 255 or off)\r\n");
-    putsUart0("delta D                      (D = 0 - 255 or off)\r\n");
-    putsUart0("match E                      (E = 0 - 255 or off)\r\n");
-    putsUart0("showColors                   (shows colors saved)\r\n");
-    putsUart0("help                         (show main menu)\r\n");
+    listCommands(COMMAND_MAIN, "%-28s (%s)\r\n");
 }
 
 void rgbLight()
@@ -668,13 +347,21 @@ void rgbLight()
 
 void rgbOff()
 {
-    parseArg(1);
-    if(strcmp("off",arg) == 0)
+    if(isArg(1, "off"))
         setRgbColor(0, 0, 0);
     else
         putsUart0("\r\nStatus: Arg not off\r\n");
 }
 
+// rgb r g b, or rgb off
+void rgbCommand()
+{
+    if(fieldCount == 4)
+        rgbLight();
+    else
+        rgbOff();
+}
+
 void light()
 {
     uint16_t raw;
@@ -706,90 +393,82 @@ void ramp()
     setRgbColor(0,0,0);
 }
 
+// Timer-triggered sweep of each LED, red, blue then green
 void test()
 {
+    static const uint8_t order[3] = {SWEEP_RED, SWEEP_BLUE, SWEEP_GREEN};
     uint16_t i;
-    uint16_t raw;
+    uint16_t count;
+    uint8_t c;
     char str[40];
 
-    for(i=0; i<1024; i++)
-    {
-        setRgbColor(i, 0, 0);
-        waitMicrosecond(10000);
-        raw = readAdc0Ss3();
-        sprintf(str, "%u, 0, 0, %u\r\n", i, raw);
-        putsUart0(str);
-    }
-    for(i=0; i<1024; i++)
-    {
-        setRgbColor(0, 0, i);
-        waitMicrosecond(10000);
-        raw = readAdc0Ss3();
-        sprintf(str, "0, 0, %u, %u\r\n", i, raw);
-        putsUart0(str);
-    }
-    for(i=0; i<1024; i++)
+    disablePeriodTimer();
+    stopMeasurement();
+    for(c=0; c<3; c++)
     {
-        setRgbColor(0, i, 0);
-        waitMicrosecond(10000);
-        raw = readAdc0Ss3();
-        sprintf(str, "0, %u, 0, %u\r\n", i, raw);
-        putsUart0(str);
+        count = runSweep(order[c], 0, sweepSamples);
+        for(i=0; i<count; i++)
+        {
+            if (order[c] == SWEEP_RED)
+                sprintf(str, "%u, 0, 0, %u\r\n", i, sweepSamples[i]);
+            else if (order[c] == SWEEP_BLUE)
+                sprintf(str, "0, 0, %u, %u\r\n", i, sweepSamples[i]);
+            else
+                sprintf(str, "0, %u, 0, %u\r\n", i, sweepSamples[i]);
+            putsUart0(str);
+        }
     }
-    setRgbColor(0,0,0);
 }
 
-void calibrate()
+// Finds the highest pwm value of each LED that keeps the light value at or
+// below threshold T, by bisection or (linear) by sweeping up from 0
+void calibrate(bool linear)
 {
-    uint16_t i;
-    uint16_t raw;
-    char str[40];
-    bool redStatus = false;
-    bool greenStatus = false;
-    bool blueStatus = false;
+    uint16_t count;
+    uint16_t pwm;
+    uint16_t steps = 0;
+    uint8_t searchSteps;
+    uint8_t c;
+    uint32_t start;
+    uint32_t ms;
+    char str[60];
+    bool status = true;
 
-    for(i=0; i<1024; i++)
-    {
-        setRgbColor(i, 0, 0);
-        waitMicrosecond(10000);
-        raw = readAdc0Ss3();
-        if (raw > T)                			// if light value reaches threshold
-        {    
-            calibration[0] = i - 1;     		// save redPwm value
-            redStatus = true;
-            break;
-        }
-    }
-    for(i=0; i<1024; i++)
+    disablePeriodTimer();
+    stopMeasurement();
+    start = readCycleCounter();
+    for(c=0; c<3; c++)
     {
-        setRgbColor(0, i, 0);
-        waitMicrosecond(10000);
-        raw = readAdc0Ss3();
-        if (raw > T)                			// if light value reaches threshold
+        if(linear)
         {
-            calibration[1] = i - 1;   			// save greenPwm value
-            greenStatus = true;
-            break;
+            count = runSweep(c, T, sweepSamples);
+            steps += count;
+            pwm = sweepSamples[count - 1] > T ? count - 1 : SWEEP_STEPS;
         }
-    }
-    for(i=0; i<1024; i++)
-    {
-        setRgbColor(0, 0, i);
-        waitMicrosecond(10000);
-        raw = readAdc0Ss3();
-        if (raw > T)                			// if light value reaches threshold
+        else
         {
-            calibration[2] = i - 1;    			// save bluePwm value
-            blueStatus = true;
-            break;
+            pwm = searchSweep(c, T, &searchSteps);
+            steps += searchSteps;
         }
+        if (pwm > 0 && pwm < SWEEP_STEPS)       // if light value reaches threshold
+            calibration[c] = pwm - 1;           // save pwm value below it
+        else
+            status = false;
     }
-    setRgbColor(0,0,0);
-    if(redStatus && greenStatus && blueStatus)
+    if(status && !learnSettle(calibration))
+        putsUart0("Status: LEDs did not settle within 10 ms\r\n");
+    getLearnedSettle(settleTimes);
+    ms = (readCycleCounter() - start) / (SYSTEM_CLOCK / 1000);
+    sprintf(str, "Calibration: %u steps in %lu ms\r\n", steps, (unsigned long)ms);
+    putsUart0(str);
+    if(status)
     {
         saveCalibrationToProm();
         sprintf(str, "(%u, %u, %u)\r\n", calibration[0], calibration[1], calibration[2]);
         putsUart0(str);
+        sprintf(str, "Settle: (%lu, %lu, %lu) us\r\n", (unsigned long)settleTimes[0],
+                (unsigned long)settleTimes[1], (unsigned long)settleTimes[2]);
+        putsUart0(str);
     }
     else
     {
@@ -797,29 +476,37 @@ void calibrate()
     }
 }
 
-// shows RGB triplet raw form, capped at T value
+// calibrate bisects, calibrate linear sweeps every pwm value to verify
+void calibrateCommand()
+{
+    if(fieldCount == 2)
+    {
+        if(isArg(1, "linear"))
+            calibrate(true);
+        else
+            putsUart0("\r\nStatus: invalid \"calibrate\" argument\r\n");
+    }
+    else
+        calibrate(false);
+}
+
 void trigger()
 {
-    NVIC_EN0_R |= 0 << (INT_TIMER1A-16);     // turn-off interrupt 37 (TIMER1A)
-    TIMER1_CTL_R &= ~TIMER_CTL_TAEN;         // turn-off timer
+    disablePeriodTimer();                    // turn-off timer
+    stopMeasurement();
     uint16_t red, green, blue;
-    char str[40];
+    char str[FMT_TRIPLET_MAX + 2];
 
     if(notCalibrated())
         return;
 
-    setRgbColor(calibration[0], 0, 0);
-    waitMicrosecond(10000);
-    red = readAdc0Ss3();
-    setRgbColor(0, calibration[1], 0);
-    waitMicrosecond(10000);
-    green = readAdc0Ss3();
-    setRgbColor(0, 0, calibration[2]);
-    waitMicrosecond(10000);
-    blue = readAdc0Ss3();
-    setRgbColor(0,0,0);
-    sprintf(str, "(%u, %u, %u)\r\n", red, green, blue);
+    measureRgb(calibration, &red, &green, &blue);
+    uint32_t start = profileStart(PROFILE_FORMAT);
+    fmtString(fmtTriplet(str, TO_12BIT(red), TO_12BIT(green), TO_12BIT(blue)), "\r\n");
+    profileEnd(PROFILE_FORMAT, start);
+    start = profileStart(PROFILE_UART);
     putsUart0(str);
+    profileEnd(PROFILE_UART, start);
 
 }
 
@@ -827,20 +514,14 @@ void trigger()
 void trigger2()
 {
     uint16_t red, green, blue;  
-    char str[40];
-
-    // ">> 3" convert raw value of 11 bits to 8 bits
-    setRgbColor(calibration[0], 0, 0);
-    waitMicrosecond(10000);
-    red = readAdc0Ss3() >> 3;
-    setRgbColor(0, calibration[1], 0);
-    waitMicrosecond(10000);
-    green = readAdc0Ss3() >> 3;
-    setRgbColor(0, 0, calibration[2]);
-    waitMicrosecond(10000);
-    blue = readAdc0Ss3() >> 3;
-    setRgbColor(0,0,0);
-    sprintf(str, "\r\n(%u, %u, %u)\r\n\r\n", red, green, blue);
+    char str[FMT_TRIPLET_MAX + 6];
+
+    // convert 16-bit samples (11-bit full scale) to 8 bits
+    measureRgb(calibration, &red, &green, &blue);
+    red = TO_8BIT(red);
+    green = TO_8BIT(green);
+    blue = TO_8BIT(blue);
+    fmtString(fmtTriplet(fmtString(str, "\r\n"), red, green, blue), "\r\n\r\n");
     putsUart0(str);
 
 }
@@ -848,8 +529,8 @@ void trigger2()
 // shows RGB triplet raw form, capped at T value
 void button()
 {
-    NVIC_EN0_R |= 0 << (INT_TIMER1A-16);   // turn-off interrupt 37 (TIMER1A)
-    TIMER1_CTL_R &= ~TIMER_CTL_TAEN;       // turn-off timer
+    disablePeriodTimer();                  // turn-off timer
+    stopMeasurement();
     uint16_t red, green, blue;
     char str[40];
 
@@ -859,17 +540,9 @@ void button()
     sprintf(str, "Press SW1 to measure\r\n");
     putsUart0(str);
     waitPb1();
-    setRgbColor(calibration[0], 0, 0);
-    waitMicrosecond(50000);
-    red = readAdc0Ss3();
-    setRgbColor(0, calibration[1], 0);
-    waitMicrosecond(10000);
-    green = readAdc0Ss3();
-    setRgbColor(0, 0, calibration[2]);
-    waitMicrosecond(10000);
-    blue = readAdc0Ss3();
-    setRgbColor(0,0,0);
-    sprintf(str, "(%u, %u, %u)\r\n", red, green, blue);
+    waitMicrosecond(40000);                // let the press settle before the red phase
+    measureRgb(calibration, &red, &green, &blue);
+    sprintf(str, "(%u, %u, %u)\r\n", TO_12BIT(red), TO_12BIT(green), TO_12BIT(blue));
     putsUart0(str);
 
 }
@@ -883,85 +556,99 @@ void periodic()
     }
     else
     {
-        if(type[1] == 1)                        // if second field is alphabetic i.e."off"
+        if(tokens[1].kind == TOKEN_ALPHA)                        // if second field is alphabetic i.e."off"
         {
-            NVIC_EN0_R |= 0 << (INT_TIMER1A-16);// turn-off interrupt 37 (TIMER1A)
-            TIMER1_CTL_R &= ~TIMER_CTL_TAEN;    // turn-off timer
-            putsUart0("Status: periodic mode off\r\n");
+            periodicFlag = false;
+            disablePeriodTimer();               // turn-off timer
+            stopMeasurement();
+            flushFrame();                       // partial batch of binary output
+            periodicStatus();
         }
         else                                    // if second field is numeric
         {
             uint32_t t = getValue(1);
             if (t == 0)
             {
-                NVIC_EN0_R |= 0 << (INT_TIMER1A-16);// turn-off interrupt 37 (TIMER1A)
-                TIMER1_CTL_R &= ~TIMER_CTL_TAEN;    // turn-off timer
-                putsUart0("Status: periodic mode off\r\n");
+                periodicFlag = false;
+                disablePeriodTimer();               // turn-off timer
+                stopMeasurement();
+                flushFrame();                       // partial batch of binary output
+                periodicStatus();
             }
+            else if (isStreaming())
+                putsUart0("\r\nStatus: turn stream mode off first\r\n");
             else
             {
+                periodicFlag = true;
                 putsUart0("Status: periodic mode on\r\n");
                 t = 40000000 * 0.1 * t;             // 40Mhz * units of 0.1 seconds of t
-                TIMER1_TAILR_R = t;                 // set new calculated load value
-                NVIC_EN0_R |= 1 << (INT_TIMER1A-16);// turn-on interrupt 37 (TIMER1A)
-                TIMER1_CTL_R |= TIMER_CTL_TAEN;     // turn-on timer
+                enablePeriodTimer(t);               // load and turn-on timer interrupt
             }
         }
     }
 }
 
-void periodIsr()
+// prints how many periodic measurements were lost since boot
+void periodicStatus()
 {
-    char str[40];
+    char str[80];
+    sprintf(str, "Status: periodic mode off (%u skipped, %u dropped)\r\n",
+            getMeasurementsSkipped(), getTripletsDropped());
+    putsUart0(str);
+}
 
-    if(ledSample)
-    {
-        GREEN_LED = 1;
-        waitMicrosecond(5000);
-        GREEN_LED = 0;
-    }
-
-    setRgbColor(calibration[0], 0, 0);
-    waitMicrosecond(10000);
-    red = readAdc0Ss3() >> 3;
-    setRgbColor(0, calibration[1], 0);
-    waitMicrosecond(10000);
-    green = readAdc0Ss3() >> 3;
-    setRgbColor(0, 0, calibration[2]);
-    waitMicrosecond(10000);
-    blue = readAdc0Ss3() >> 3;
-    setRgbColor(0,0,0);
+// Timer1A: starts a measurement sequence, the main loop handles the result
+void periodIsr()
+{
+    clearPeriodTimerInt();                          // clear bit (processed interrupt)
+    startMeasurement(calibration, ledSample);
+}
 
-    TIMER1_ICR_R = TIMER_ICR_TATOCINT;              // clear bit (processed interrupt)
+// reports a triplet completed by the periodic measurement sequence
+void processTriplet()
+{
+    char str[FMT_TRIPLET_MAX + 4];
+    uint32_t start;
 
     if(!matchFlag && !deltaFlag)
     {
-        sprintf(str, "\r\n(%u, %u, %u)\r\n", red, green, blue);
+        start = profileStart(PROFILE_FORMAT);
+        fmtString(fmtTriplet(fmtString(str, "\r\n"), red, green, blue), "\r\n");
+        profileEnd(PROFILE_FORMAT, start);
+        start = profileStart(PROFILE_UART);
         putsUart0(str);
+        profileEnd(PROFILE_UART, start);
         return;
     }
 
     if(matchFlag)
+    {
+        start = profileStart(PROFILE_MATCH);
         match();
+        profileEnd(PROFILE_MATCH, start);
+    }
 
     if(deltaFlag)
+    {
+        start = profileStart(PROFILE_DELTA);
         delta();
+        profileEnd(PROFILE_DELTA, start);
+    }
 }
 
 void led()
 {
-    parseArg(1);
-    if(strcmp("on", arg) == 0)
+    if(isArg(1, "on"))
     {
         putsUart0("Status: led on\r\n");
-        GREEN_LED = 1;
+        setGreenLed(true);
     }
-    else if(strcmp("off", arg) == 0)
+    else if(isArg(1, "off"))
     {
         putsUart0("Status: led off\r\n");
-        GREEN_LED = 0;
+        setGreenLed(false);
     }
-    else if(strcmp("sample", arg) == 0)
+    else if(isArg(1, "sample"))
     {
         putsUart0("Status: led sample on\r\n");
         ledSample = true;          // set flag for periodic ISR to blink light
@@ -972,30 +659,39 @@ void led()
 
 void colorN()
 {
-    char str[50];
+    char str[60];
 
     if(notCalibrated())
         return;
 
     uint16_t n;
     n = getValue(1);
-    setRgbColor(calibration[0], 0, 0);
-    waitMicrosecond(10000);
-    red = readAdc0Ss3() >> 3;
-    setRgbColor(0, calibration[1], 0);
-    waitMicrosecond(10000);
-    green = readAdc0Ss3() >> 3;
-    setRgbColor(0, 0, calibration[2]);
-    waitMicrosecond(10000);
-    blue = readAdc0Ss3() >> 3;
-    setRgbColor(0,0,0);
-
-    // store valid bit and rgb values at index n
-    colors[n][0] = 0;
-    colors[n][1] = red;
-    colors[n][2] = green;
-    colors[n][3] = blue;
-    saveColorToProm();
+    if(n >= COLOR_SLOTS)
+    {
+        putsUart0("\r\nStatus: color index is 0 - 79\r\n");
+        return;
+    }
+    measureRgb(calibration, &red, &green, &blue);
+    red = TO_8BIT(red);
+    green = TO_8BIT(green);
+    blue = TO_8BIT(blue);
+    // a record holds a byte per channel
+    if(red > 255)
+        red = 255;
+    if(green > 255)
+        green = 255;
+    if(blue > 255)
+        blue = 255;
+
+    // store valid bit and rgb values at index n
+    uint32_t start = profileStart(PROFILE_EEPROM);
+    bool saved = saveColor(n, red, green, blue);
+    profileEnd(PROFILE_EEPROM, start);
+    if(!saved)
+    {
+        putsUart0("Status: failed to save color to EEPROM\r\n");
+        return;
+    }
     sprintf(str, "Status: saved (%u, %u, %u) at index %u\r\n", red, green, blue, n);
     putsUart0(str);
 }
@@ -1004,11 +700,18 @@ void colorN()
 void showN()
 {
     uint16_t n;
+    uint8_t r, g, b;
     n = getValue(1);
-    setRgbColor(colors[n][1], colors[n][2], colors[n][3]);
+    if(n >= COLOR_SLOTS)
+    {
+        putsUart0("\r\nStatus: color index is 0 - 79\r\n");
+        return;
+    }
+    getColor(n, &r, &g, &b);
+    setRgbColor(r, g, b);
     putsUart0("\r\nPress any key to continue\r\n");
-    getcUart0();
-    setRgbColor(0, 0, 0);
+    armAnyKey();                        // main loop turns the LEDs off on the next key
+    showActive = true;
 }
 
 
@@ -1016,15 +719,17 @@ void showN()
 void showColors()
 {
     uint8_t i;
+    uint8_t r, g, b;
     uint8_t colorCount = 0;
     char str[50];
     putsUart0("Current saved colors:\r\n");
-    for(i=0; i<16; i++)
+    for(i=0; i<COLOR_SLOTS; i++)
     {
-        if(colors[i][0] == 0)
+        if(isColorValid(i))
         {
             colorCount++;
-            sprintf(str,"Color %2u:  (%3u, %3u, %3u)\r\n", i, colors[i][1], colors[i][2], colors[i][3]);
+            getColor(i, &r, &g, &b);
+            sprintf(str,"Color %2u:  (%3u, %3u, %3u)\r\n", i, r, g, b);
             putsUart0(str);
         }
     }
@@ -1035,8 +740,14 @@ void showColors()
 
 void eraseN()
 {
-    uint8_t n = getValue(1);
-    colors[n][0] = 0xFFFFFFFF;           // 0xFFFFFFFF = invalid
+    uint16_t n = getValue(1);
+    if(n >= COLOR_SLOTS)
+    {
+        putsUart0("\r\nStatus: color index is 0 - 79\r\n");
+        return;
+    }
+    if(!eraseColor(n))                   // clears the valid bit in RAM and EEPROM
+        putsUart0("Status: failed to erase color in EEPROM\r\n");
 }
 
 // for current sample's distance vector, it will compare with all stored color's
@@ -1044,221 +755,941 @@ void eraseN()
 // color index
 void match()
 {
-    float Ei;
     uint8_t i;
-    uint16_t reds, greens, blues;
+    uint8_t hits[COLOR_SLOTS];
+    uint8_t matches;
+    uint16_t ids[LIBRARY_REPORT];
+    uint16_t found;
     char str[40];
 
     if(notCalibrated())
         return;
 
-    for(i=0; i<16; i++)
+    // squared distance of each valid color against E^2
+    matches = matchUserColors(red, green, blue, E2, hits);
+    for(i=0; i<matches; i++)
+    {
+        fmtString(fmtUnsigned(fmtString(str, "Color "), hits[i]), "\r\n");
+        putsUart0(str);
+    }
+
+    // reference shades, by their line in library.csv
+    if(libraryFlag)
     {
-        if(colors[i][0] == 0)               // if valid color
+        found = libraryMatch(&referenceLibrary, red, green, blue, E2, ids, LIBRARY_REPORT);
+        for(i=0; i<found && i<LIBRARY_REPORT; i++)
         {
-            // r - ri
-            reds = abs(red - colors[i][1]);
-            greens = abs(green - colors[i][2]);
-            blues = abs(blue - colors[i][3]);
-            // (r - ri)^2
-            reds = pow(reds, 2);
-            greens = pow(greens, 2);
-            blues = pow(blues, 2);
-            Ei = sqrt(reds + greens + blues);
-            if(Ei < E)
-            {
-                sprintf(str, "Color %u\r\n", i);
-                putsUart0(str);
-            }
+            fmtString(fmtUnsigned(fmtString(str, "Shade "), ids[i]), "\r\n");
+            putsUart0(str);
+        }
+        if(found > LIBRARY_REPORT)
+        {
+            sprintf(str, "(%u more shades)\r\n", found - LIBRARY_REPORT);
+            putsUart0(str);
         }
     }
 }
 
+// match E turns match mode on with threshold E, match off turns it off
+void matchCommand()
+{
+    if(tokens[1].kind == TOKEN_ALPHA)
+    {
+        matchFlag = false;  // turn match mode off
+    }
+    else
+    {
+        matchFlag = true;   // turn match mode on
+        E = getValue(1);
+        E2 = (uint32_t)E * E;
+    }
+}
+
 // for each sample taken periodically, if the difference between the sample and 
 // the current infinite impulse response is more than variable D, it will 
 // display (r, g, b) values
 void delta()
 {
-    char str[40];
-    float v, result;
-    float alpha = 0.9;
+    static const char* names[3] = {" red ", " green ", " blue "};
+    char str[FMT_TRIPLET_MAX + 40], *p;
+    uint16_t rgb[3] = {red, green, blue};
+    int16_t steps[3];
+    uint8_t changed, i;
 
     if(notCalibrated())
         return;
 
-    // deltaD command
-    v = sqrt(pow(red, 2) + pow(green, 2) + pow(blue, 2));
-    iir = (alpha * iir) + (1-alpha) * v;
-    result = fabs(v - iir);
-    if(result > D)
+    // deltaD command, fixed-point average of the magnitude
+    if(getFilterCount() == 0)
+    {
+        if(updateDelta(red, green, blue, D))
+        {
+            fmtString(fmtTriplet(str, red, green, blue), "\r\n");
+            putsUart0(str);
+        }
+        return;
+    }
+
+    // filter pipeline, reports the filtered triplet and which way each channel moved
+    changed = runFilters(rgb, D, steps);
+    if(changed)
     {
-        sprintf(str, "(%u, %u, %u)\r\n", red, green, blue);
+        p = fmtTriplet(str, rgb[0], rgb[1], rgb[2]);
+        for(i = 0; i < 3; i++)
+        {
+            if(!(changed & (1 << i)))
+                continue;
+            p = fmtString(fmtString(p, names[i]), steps[i] < 0 ? "-" : "+");
+            p = fmtUnsigned(p, steps[i] < 0 ? -steps[i] : steps[i]);
+        }
+        fmtString(p, "\r\n");
         putsUart0(str);
     }
 }
 
+// delta D turns delta mode on with threshold D, delta off turns it off
+void deltaCommand()
+{
+    if(tokens[1].kind == TOKEN_ALPHA)        // second argument is alphabetic
+    {
+        deltaFlag = false;  // turn delta mode off
+    }
+    else
+    {
+        deltaFlag = true;
+        resetDelta();       // reset average values
+        resetFilters();
+        D = getValue(1);
+    }
+}
 
-//-----------------------------------------------------------------------------
-// Main
-//-----------------------------------------------------------------------------
-
-int main(void)
+// dumps the time spent in each measurement and reporting phase since the
+// last "profile reset"
+void profile()
 {
-    uint16_t promSuccess = 0;
+    struct profileStats stats;
+    char str[100], *p;
+    uint8_t i, j;
+    bool any = false;
 
-    // Initialize hardware
-	initHw();
-    
-    // Initialize EEPROM
-    promSuccess = enableEeprom();
-    while(promSuccess != 0)
+    if(isArg(1, "reset"))
     {
-        promSuccess = enableEeprom();
+        resetProfile();
+        putsUart0("Status: profile reset\r\n");
+        return;
     }
-    readFromProm();
-    
-	showMenu();
-    while(true)
+    for(i = 0; i < PROFILE_PHASES; i++)
     {
-        char str[40];
-        bool status = false;
-        putsUart0("\r\n");
-        putsUart0("Enter command: ");
-        getsUart0(strInput);
-        tokenizeStr();
-        parseCmd(0);
-        if(isCommand("help") || isCommand("menu"))
+        if(!getProfile(i, &stats))
+            continue;
+        any = true;
+        sprintf(str, "Profile %-9s %6lu x  min %lu  avg %lu  max %lu us\r\n", getProfileName(i),
+                (unsigned long)stats.count, (unsigned long)(stats.min / (SYSTEM_CLOCK / 1000000)),
+                (unsigned long)(stats.total / stats.count / (SYSTEM_CLOCK / 1000000)),
+                (unsigned long)(stats.max / (SYSTEM_CLOCK / 1000000)));
+        putsUart0(str);
+
+        // histogram, buckets of 2^n to 2^(n+1) - 1 cycles
+        p = fmtString(str, "  cycles");
+        for(j = 0; j < PROFILE_BUCKETS; j++)
         {
-            showMenu();
-            status = true;
+            if(stats.buckets[j] == 0)
+                continue;
+            if(p - str > (int)sizeof(str) - 20)
+            {
+                fmtString(p, "\r\n");
+                putsUart0(str);
+                p = fmtString(str, "  cycles");
+            }
+            p = fmtUnsigned(fmtString(fmtUnsigned(fmtString(p, " 2^"), j), ":"), stats.buckets[j]);
         }
-        else if(isCommand("rgb"))
+        fmtString(p, "\r\n");
+        putsUart0(str);
+    }
+    if(!any)
+        putsUart0("Profile: nothing measured since the last reset\r\n");
+}
+
+// builds the delta filter pipeline a stage at a time and shows the cycles
+// each stage takes per sample
+void filterCommand()
+{
+    static const char* types[] = {"ema", "mean", "median", "change"};
+    char str[80];
+    uint32_t average, max;
+    uint8_t i, type = FILTER_NONE;
+
+    if(isArg(1, "off"))
+        clearFilters();
+    else if(fieldCount == 3)
+    {
+        for(i = 0; i < 4; i++)
+            if(isArg(1, types[i]))
+                type = FILTER_EMA + i;
+        if(type == FILTER_NONE)
         {
-            if(fieldCount == 4)
-                rgbLight();
-            else
-                rgbOff();
-            status = true;
+            putsUart0("\r\nStatus: invalid \"filter\" argument\r\n");
+            return;
         }
-        else if(isCommand("light"))
+        if(!addFilter(type, getValue(2)))
         {
-            light();
-            status = true;
+            sprintf(str, "\r\nStatus: pipeline full (%u) or %s value out of range\r\n", FILTER_STAGES, types[type - FILTER_EMA]);
+            putsUart0(str);
+            return;
         }
-        else if(isCommand("ramp"))
+    }
+    else if(fieldCount != 1)
+    {
+        putsUart0("\r\nStatus: invalid \"filter\" argument\r\n");
+        return;
+    }
+    if(getFilterCount() == 0)
+    {
+        putsUart0("Filter: none, delta uses the magnitude average (alpha 0.9)\r\n");
+        return;
+    }
+    for(i = 0; i <= getFilterCount(); i++)
+    {
+        getFilterCycles(i, &average, &max);
+        if(i < getFilterCount())
+            sprintf(str, "Filter %u: %s %u, %lu cycles avg, %lu max\r\n", i + 1, getFilterName(getFilterType(i)),
+                    getFilterParameter(i), (unsigned long)average, (unsigned long)max);
+        else if(max != 0)
+            sprintf(str, "Filter %u: change D, %lu cycles avg, %lu max\r\n", i + 1,
+                    (unsigned long)average, (unsigned long)max);
+        else
+            break;
+        putsUart0(str);
+    }
+}
+
+// shows or sets how many conversions make up each measurement sample
+void adcMode()
+{
+    char str[100];
+
+    if(fieldCount == 3)
+        setAcquisition(getValue(1), getValue(2));
+    sprintf(str, "ADC: %ux hardware averaging, %u samples per led, %u conversions per sample\r\n",
+            getAverage(), getBurst(), getAverage() * getBurst());
+    putsUart0(str);
+}
+
+// shows or sets the time each sweep point settles before it is sampled
+void sweepMode()
+{
+    char str[60];
+
+    if(fieldCount == 2)
+        setSweepPeriod(getValue(1));
+    sprintf(str, "Sweep: %lu us per point\r\n", (unsigned long)getSweepPeriod());
+    putsUart0(str);
+}
+
+// shows or sets how long each LED settles before it is sampled
+void settle()
+{
+    char str[80];
+    uint32_t us[3];
+    const char* modes[] = {"fixed", "learned", "adaptive"};
+
+    if(fieldCount >= 2)
+    {
+        if(isArg(1, "fixed"))
+            setSettleMode(SETTLE_FIXED);
+        else if(isArg(1, "learned"))
+            setSettleMode(SETTLE_LEARNED);
+        else if(isArg(1, "adaptive"))
+            setSettleMode(SETTLE_ADAPTIVE);
+        else
         {
-            ramp();
-            status = true;
+            putsUart0("\r\nStatus: invalid \"settle\" argument\r\n");
+            return;
         }
-        else if(isCommand("test"))
+        if(fieldCount == 3)
+            setSettleTolerance(getValue(2));
+    }
+    sprintf(str, "Settle: %s, tolerance %u counts, %lu timeouts\r\n", modes[getSettleMode()],
+            getSettleTolerance(), (unsigned long)getSettleTimeouts());
+    putsUart0(str);
+    getLearnedSettle(us);
+    sprintf(str, "Learned: (%lu, %lu, %lu) us\r\n", (unsigned long)us[0], (unsigned long)us[1], (unsigned long)us[2]);
+    putsUart0(str);
+    getLastSettle(us);
+    sprintf(str, "Last adaptive: (%lu, %lu, %lu) us\r\n", (unsigned long)us[0], (unsigned long)us[1], (unsigned long)us[2]);
+    putsUart0(str);
+}
+
+// shows ambient tracking or sets how often the dark value is refreshed
+void darkFrame()
+{
+    char str[100];
+
+    if(fieldCount == 2 && tokens[1].kind == TOKEN_NUMBER)
+        setDarkInterval(getValue(1));
+    else if(fieldCount == 2)
+    {
+        if(!isArg(1, "reset"))
         {
-        	test();
-            status = true;
+            putsUart0("\r\nStatus: invalid \"dark\" argument\r\n");
+            return;
         }
-        else if(isCommand("calibrate"))
+        resetDarkStats();
+    }
+    if(getDarkInterval() == 0)
+        putsUart0("Dark: off\r\n");
+    else
+    {
+        sprintf(str, "Dark: every %u triplets, last %u, min %u, max %u\r\n", getDarkInterval(),
+                TO_12BIT(getDark()), TO_12BIT(getDarkMin()), TO_12BIT(getDarkMax()));
+        putsUart0(str);
+    }
+    sprintf(str, "Ambient: %lu refreshes, %lu changed by more than %u, largest step %u\r\n",
+            (unsigned long)getDarkRefreshes(), (unsigned long)getDarkChanges(), TO_12BIT(DARK_CHANGE),
+            TO_12BIT(getDarkLargestStep()));
+    putsUart0(str);
+}
+
+// shows the reference library or turns its matching on and off
+void referenceColors()
+{
+    char str[80];
+
+    if(fieldCount == 2)
+    {
+        if(isArg(1, "on"))
+            libraryFlag = true;
+        else if(isArg(1, "off"))
+            libraryFlag = false;
+        else
         {
-            calibrate();
-        	status = true;
+            putsUart0("\r\nStatus: invalid \"library\" argument\r\n");
+            return;
         }
-        else if(isCommand("trigger"))
+    }
+    sprintf(str, "Library: %u shades, %u^3 grid, match %s\r\n", referenceLibrary.count,
+            1 << referenceLibrary.gridBits, libraryFlag ? "on" : "off");
+    putsUart0(str);
+}
+
+// runs one of the kernel benchmarks
+void bench()
+{
+    uint16_t samples = BENCH_SAMPLES;
+
+    if(fieldCount == 3 && getValue(2) > 0)
+        samples = getValue(2);
+    if(isArg(1, "distance"))
+        benchDistance(samples);
+    else if(isArg(1, "library"))
+        benchLibrary(samples);
+    else if(isArg(1, "packed"))
+        benchPacked(samples);
+    else if(isArg(1, "fmt"))
+        benchFormat(samples);
+    else if(isArg(1, "tokens"))
+        benchTokens(samples);
+    else
+        putsUart0("\r\nStatus: invalid \"bench\" argument\r\n");
+}
+
+// switches periodic output between text and binary frames
+void outputMode()
+{
+    char str[120];
+    uint32_t triplets;
+
+    if(fieldCount >= 2)
+    {
+        if(isArg(1, "text"))
         {
-        	trigger();
-        	status = true;
+            flushFrame();
+            binaryFlag = false;
         }
-        else if(isCommand("button"))
+        else if(isArg(1, "binary"))
         {
-    		button();
-    		status = true;
+            if(!binaryFlag)
+                resetFrames();
+            binaryFlag = true;
+            setFrameBatch(fieldCount == 3 ? getValue(2) : 1);
         }
-        else if(isCommand("periodic"))
+        else
         {
-            periodic();
-            status = true;
+            putsUart0("\r\nStatus: invalid \"output\" argument\r\n");
+            return;
         }
-        else if(isCommand("led"))
+    }
+    triplets = getFrameTripletsSent();
+    sprintf(str, "Output: %s, %u triplets per frame, %lu frames, %lu triplets, %lu.%02lu bytes per triplet\r\n",
+            binaryFlag ? "binary" : "text", getFrameBatch(), (unsigned long)getFramesSent(), (unsigned long)triplets,
+            (unsigned long)(triplets ? getFrameBytesSent() / triplets : 0),
+            (unsigned long)(triplets ? getFrameBytesSent() * 100 / triplets % 100 : 0));
+    putsUart0(str);
+}
+
+// Q8 16-bit sample units as 12-bit counts with one decimal
+static char* fmtCounts(char* p, uint32_t q8)
+{
+    uint32_t tenths = (q8 * 10 + (1 << 11)) >> 12;
+    p = fmtUnsigned(p, tenths / 10);
+    *p++ = '.';
+    return fmtUnsigned(p, tenths % 10);
+}
+
+// prints the window statistics and control limits of one channel
+static void spcChannel(uint8_t channel)
+{
+    static const char* names[3] = {"red", "green", "blue"};
+    struct spcStats stats;
+    struct spcLimits limits;
+    char str[160], *p;
+
+    p = fmtString(fmtString(str, "SPC "), names[channel]);
+    if(getSpcStats(channel, false, &stats) || getSpcStats(channel, true, &stats))
+    {
+        p = fmtCounts(fmtString(p, ": mean "), stats.mean);
+        p = fmtCounts(fmtString(p, " sd "), stats.sigma);
+        p = fmtUnsigned(fmtString(p, " min "), TO_12BIT(stats.min));
+        p = fmtUnsigned(fmtString(p, " max "), TO_12BIT(stats.max));
+        p = fmtUnsigned(fmtString(p, " over "), stats.count);
+    }
+    else
+        p = fmtString(p, ": no samples");
+    if(getSpcLimits(channel, &limits))
+    {
+        p = fmtCounts(fmtString(p, ", X-bar "), limits.xbar);
+        p = fmtCounts(fmtString(p, " ("), limits.xbarLower);
+        p = fmtCounts(fmtString(p, " - "), limits.xbarUpper);
+        p = fmtCounts(fmtString(p, "), R "), limits.range);
+        p = fmtCounts(fmtString(p, " ("), limits.rangeLower);
+        p = fmtCounts(fmtString(p, " - "), limits.rangeUpper);
+        p = fmtUnsigned(fmtString(p, "), "), limits.alarms);
+        p = fmtString(p, " alarms");
+    }
+    fmtString(p, "\r\n");
+    putsUart0(str);
+}
+
+// prints the statistics summary
+void spcStatus()
+{
+    char str[100];
+    uint8_t i;
+
+    sprintf(str, "SPC: %s, window %u, subgroup %u, %lu samples, %lu subgroups%s\r\n",
+            spcFlag ? "on" : "off", getSpcWindow(), getSpcSubgroup(), (unsigned long)getSpcSamples(),
+            (unsigned long)getSpcSubgroups(), getSpcSubgroups() < SPC_BASELINE ? ", learning limits" : "");
+    putsUart0(str);
+    for(i = 0; i < 3; i++)
+        spcChannel(i);
+}
+
+// adds a periodic triplet to the statistics, reporting only channels that go
+// out of control
+void spcTriplet()
+{
+    static const char* names[3] = {"red", "green", "blue"};
+    uint16_t rgb[3] = {red, green, blue};
+    uint16_t alarms = addSpcSample(rgb);
+    uint8_t i, bits;
+    char str[100];
+
+    if(alarms == 0)
+        return;
+    for(i = 0; i < 3; i++)
+    {
+        bits = SPC_ALARMS(alarms, i);
+        if(bits == 0)
+            continue;
+        sprintf(str, "SPC alarm: %s%s%s%s%s at sample %lu\r\n", names[i],
+                bits & SPC_XBAR_HIGH ? " X-bar high" : "", bits & SPC_XBAR_LOW ? " X-bar low" : "",
+                bits & SPC_RANGE_HIGH ? " R high" : "", bits & SPC_RANGE_LOW ? " R low" : "",
+                (unsigned long)getSpcSamples());
+        putsUart0(str);
+        spcChannel(i);
+    }
+}
+
+// keeps periodic triplets on the device as rolling statistics with X-bar/R
+// alarms; "spc" alone prints the summary
+void spcCommand()
+{
+    if(fieldCount >= 2)
+    {
+        if(isArg(1, "on"))
         {
-            led();
-            status = true;
+            startSpc(fieldCount >= 3 ? getValue(2) : SPC_WINDOW, fieldCount >= 4 ? getValue(3) : SPC_SUBGROUP);
+            spcFlag = true;
         }
-        else if(isCommand("color"))
+        else if(isArg(1, "off"))
+            spcFlag = false;
+        else
         {
-            colorN();
-            status = true;
+            putsUart0("\r\nStatus: invalid \"spc\" argument\r\n");
+            return;
+        }
+    }
+    spcStatus();
+}
+
+// prints the stream totals: samples sent, sustained rate, dropped buffers
+void streamStatus()
+{
+    char str[120];
+    uint64_t clocks = getStreamClocks();
+    uint32_t taken = getStreamSamples() + getStreamDroppedSamples();
+    uint32_t rate = clocks ? (uint32_t)((uint64_t)(taken - 1) * SYSTEM_CLOCK * 10 / clocks) : 0;
+
+    sprintf(str, "Stream: %s, %lu samples in %lu frames, %lu bytes, %lu.%lu samples/s measured\r\n",
+            isStreaming() ? "on" : "off", (unsigned long)getStreamSamples(), (unsigned long)getStreamFrames(),
+            (unsigned long)getStreamBytes(), (unsigned long)(rate / 10), (unsigned long)(rate % 10));
+    putsUart0(str);
+    sprintf(str, "Stream: %lu buffers dropped (%lu samples), %lu ms\r\n",
+            (unsigned long)getStreamDroppedBuffers(), (unsigned long)getStreamDroppedSamples(),
+            (unsigned long)(clocks / (SYSTEM_CLOCK / 1000)));
+    putsUart0(str);
+}
+
+// runs measurements back-to-back as binary frames sent by uDMA; text output
+// waits until "stream off"
+void streamCommand()
+{
+    if(fieldCount == 1)
+    {
+        streamStatus();
+        return;
+    }
+    if(isArg(1, "off"))
+    {
+        stopStream();
+        streamStatus();
+        return;
+    }
+    if(!isArg(1, "on"))
+    {
+        putsUart0("\r\nStatus: invalid \"stream\" argument\r\n");
+        return;
+    }
+    if(notCalibrated())
+        return;
+    if(periodicFlag || isMeasuring())
+    {
+        putsUart0("\r\nStatus: turn periodic mode off first\r\n");
+        return;
+    }
+    if(isStreaming())
+        return;
+    putsUart0("Status: stream mode on, binary frames until \"stream off\"\r\n");
+    if(!startStream(calibration))
+        putsUart0("\r\nStatus: stream did not start\r\n");
+}
+
+// switches the uart rate; the host has BAUD_CONFIRM_MS to send "ok" at the new
+// rate, otherwise the old rate comes back
+void baud()
+{
+    char str[100];
+    uint32_t old = getUart0Baud();
+    uint32_t rate, start, state;
+    bool confirmed = false;
+
+    if(fieldCount == 1)
+    {
+        sprintf(str, "Baud: %lu, %lu receive errors\r\n", (unsigned long)old, (unsigned long)getUart0RxErrors());
+        putsUart0(str);
+        return;
+    }
+    rate = getLongValue(1);
+    if(rate < BAUD_MIN || rate > BAUD_MAX)
+    {
+        sprintf(str, "\r\nStatus: baud is %u - %lu\r\n", BAUD_MIN, (unsigned long)BAUD_MAX);
+        putsUart0(str);
+        return;
+    }
+    if(isMeasuring())
+    {
+        putsUart0("\r\nStatus: turn periodic mode off first\r\n");
+        return;
+    }
+    sprintf(str, "Status: switching to %lu baud, send \"ok\" within %u s\r\n", (unsigned long)rate, BAUD_CONFIRM_MS / 1000);
+    putsUart0(str);
+    flushUart0();
+    setUart0Baud(rate);
+
+    // sleep between lines, the wake timer bounds the wait
+    startWakeTimer(100000);
+    start = readCycleCounter();
+    while(!confirmed && readCycleCounter() - start < (uint32_t)BAUD_CONFIRM_MS * (SYSTEM_CLOCK / 1000))
+    {
+        if(getsUart0(strInput))
+            confirmed = strcmp(strInput, "ok") == 0;
+        state = disableInterrupts();
+        if(!isRxPending())
+            waitForInput();
+        restoreInterrupts(state);
+    }
+    stopWakeTimer();
+
+    if(!confirmed)
+    {
+        setUart0Baud(old);
+        sprintf(str, "\r\nStatus: not confirmed, back to %lu baud\r\n", (unsigned long)getUart0Baud());
+    }
+    else
+        sprintf(str, "\r\nStatus: now at %lu baud (divisor gives %lu)\r\n", (unsigned long)rate, (unsigned long)getUart0Baud());
+    putsUart0(str);
+}
+
+// runs bytes through the uart loopback, or through the cable and back from
+// the host with echo, at the current rate
+void linkTest()
+{
+    char str[120];
+    uint16_t count = 1000, good, lost, corrupt;
+    uint32_t flagged, clocks, rate;
+    bool echo = false;
+    uint8_t n = 1;
+
+    if(fieldCount > 1 && tokens[1].kind == TOKEN_ALPHA)
+    {
+        if(!isArg(1, "echo"))
+        {
+            putsUart0("\r\nStatus: invalid \"linktest\" argument\r\n");
+            return;
         }
-        else if(isCommand("show"))
+        echo = true;
+        n++;
+    }
+    if(fieldCount > n)
+        count = getValue(n);
+    if(count == 0 || count > LINK_TEST_MAX)
+    {
+        sprintf(str, "\r\nStatus: linktest is 1 - %u bytes\r\n", LINK_TEST_MAX);
+        putsUart0(str);
+        return;
+    }
+    if(echo)
+    {
+        sprintf(str, "\r\n%s%u\r\n", LINK_ECHO_TAG, count);   // the tag starts a line
+        putsUart0(str);
+    }
+    good = runLinkTest(count, echo, &lost, &corrupt, &flagged, &clocks);
+    rate = clocks ? (uint64_t)good * SYSTEM_CLOCK / clocks : 0;
+    sprintf(str, "Link %s: %u/%u bytes in %lu us, %lu bytes/s at %lu baud (%lu%% of line rate)\r\n",
+            echo ? "echo" : "loopback", good, count, (unsigned long)(clocks / (SYSTEM_CLOCK / 1000000)),
+            (unsigned long)rate, (unsigned long)getUart0Baud(), (unsigned long)(rate * 1000 / getUart0Baud()));
+    putsUart0(str);
+    sprintf(str, "Errors: %u lost, %u corrupt, %lu flagged by the uart\r\n", lost, corrupt, (unsigned long)flagged);
+    putsUart0(str);
+}
+
+// shows the transmit buffer state or sets what happens when it overflows
+void uartTx()
+{
+    char str[80];
+    const char* policies[] = {"block", "drop newest", "drop oldest"};
+
+    if(fieldCount == 2)
+    {
+        if(isArg(1, "block"))
+            setTxPolicy(TX_BLOCK);
+        else if(isArg(1, "newest"))
+            setTxPolicy(TX_DROP_NEWEST);
+        else if(isArg(1, "oldest"))
+            setTxPolicy(TX_DROP_OLDEST);
+        else
         {
-            showN();
-            status = true;
+            putsUart0("\r\nStatus: invalid \"uart\" argument\r\n");
+            return;
         }
-        else if(isCommand("erase"))
+    }
+    sprintf(str, "TX buffer: %u/%u used, high water %u, %u dropped, policy %s\r\n",
+            getTxUsed(), TX_BUFFER_SIZE, getTxHighWater(), getTxDropped(), policies[getTxPolicy()]);
+    putsUart0(str);
+    sprintf(str, "RX lines: %u queued max, %u dropped\r\n", RX_LINES, getRxLinesDropped());
+    putsUart0(str);
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+// runs every step of script back to back, one status line at the end; what
+// the handlers print is discarded
+void runScript(const struct script* script)
+{
+    const struct command* command;
+    uint32_t start = readCycleCounter();
+    uint16_t n = 0;
+    uint8_t steps = 0, failed = 0, used, opcode;
+    char str[80];
+
+    while(n < script->length)
+    {
+        used = decodeStep(&script->code[n], script->length - n, &opcode, strInput, tokens, &fieldCount);
+        if(used == 0)
         {
-            eraseN();
-            status = true;
+            failed++;               // truncated step, nothing after it can be trusted
+            break;
         }
-        else if(isCommand("match"))
+        n += used;
+        command = opcode < commandTable.count ? &commandTable.commands[opcode] : NULL;
+        if(command != NULL && checkArgs(command->args, fieldCount, tokens))
+        {
+            muteUart0(true);
+            command->handler();
+            muteUart0(false);
+            steps++;
+        }
+        else
+            failed++;
+    }
+    sprintf(str, "Script %s: %u steps in %lu ms, %u failed\r\n", script->name, steps,
+            (unsigned long)((readCycleCounter() - start) / (SYSTEM_CLOCK / 1000)), failed);
+    putsUart0(str);
+}
+
+// adds the validated command line to the script being recorded
+void recordStep(const struct command* command)
+{
+    uint8_t used;
+    char str[60];
+
+    if(command->handler == baud)
+    {
+        putsUart0("\r\nStatus: baud waits for the host, it cannot be scripted\r\n");
+        return;
+    }
+    used = encodeStep(&recording.code[recording.length], SCRIPT_CODE_MAX - recording.length,
+                      command - commandTable.commands, strInput, tokens, fieldCount);
+    if(used == 0 || recording.steps == 255)
+    {
+        putsUart0("\r\nStatus: script is full, step not recorded\r\n");
+        return;
+    }
+    recording.length += used;
+    recording.steps++;
+    sprintf(str, "Step %u recorded, %u of %u bytes\r\n", recording.steps, recording.length, SCRIPT_CODE_MAX);
+    putsUart0(str);
+}
+
+// lists the script slots
+void listScripts()
+{
+    const char* states[] = {"", "", ", corrupt", ", stale"};
+    uint8_t slot, state;
+    char str[80];
+
+    for(slot = 0; slot < SCRIPT_SLOTS; slot++)
+    {
+        state = readScript(slot, &scratchScript, tableSignature);
+        if(state == SCRIPT_EMPTY)
+            sprintf(str, "Script slot %u: empty\r\n", slot);
+        else if(state == SCRIPT_CORRUPT)
+            sprintf(str, "Script slot %u: corrupt\r\n", slot);
+        else
+            sprintf(str, "Script slot %u: %s, %u steps, %u bytes%s%s\r\n", slot, scratchScript.name,
+                    scratchScript.steps, scratchScript.length, scratchScript.boot ? ", runs at boot" : "",
+                    states[state]);
+        putsUart0(str);
+    }
+}
+
+// script lists, script record|run|erase|boot name and script end manage them
+void scriptCommand()
+{
+    char name[SCRIPT_NAME_MAX + 1];
+    char str[60];
+    uint8_t slot;
+
+    if(fieldCount == 1)
+    {
+        listScripts();
+        return;
+    }
+    if(fieldCount == 2)
+    {
+        if(!isArg(1, "end") || !recordFlag)
+            putsUart0("\r\nStatus: invalid \"script\" argument\r\n");
+        else
         {
-            if(type[1] == 1)
+            recordFlag = false;
+            slot = findScript(recording.name, tableSignature, &scratchScript);
+            if(slot != SCRIPT_NONE && readScript(slot, &scratchScript, tableSignature) == SCRIPT_VALID)
+                recording.boot = scratchScript.boot;
+            if(recording.steps == 0)
+                putsUart0("Status: no steps, script not saved\r\n");
+            else if(writeScript(&recording, tableSignature, &scratchScript))
             {
-                matchFlag = false;  // turn match mode off
+                sprintf(str, "Status: script %s saved, %u steps\r\n", recording.name, recording.steps);
+                putsUart0(str);
             }
             else
-            {
-                matchFlag = true;   // turn match mode on
-                E = getValue(1);
-            }
-            status = true;
+                putsUart0("Status: failed to save script to EEPROM\r\n");
         }
-        else if(isCommand("delta"))
+        return;
+    }
+    if(tokens[2].length > SCRIPT_NAME_MAX)
+    {
+        putsUart0("\r\nStatus: script names are 1 - 11 characters\r\n");
+        return;
+    }
+    memcpy(name, &strInput[tokens[2].offset], tokens[2].length);
+    name[tokens[2].length] = '\0';
+
+    if(isArg(1, "record"))
+    {
+        memset(&recording, 0, sizeof(recording));
+        strcpy(recording.name, name);
+        recordFlag = true;
+        putsUart0("Status: recording, \"script end\" saves\r\n");
+        return;
+    }
+    if(isArg(1, "boot") && strcmp(name, "off") == 0)
+    {
+        if(!setBootScript(SCRIPT_NONE, tableSignature, &scratchScript))
+            putsUart0("Status: failed to save script to EEPROM\r\n");
+        return;
+    }
+    slot = findScript(name, tableSignature, &scratchScript);
+    if(slot == SCRIPT_NONE)
+    {
+        putsUart0("\r\nStatus: no script by that name\r\n");
+        return;
+    }
+    if(isArg(1, "erase"))
+    {
+        if(!eraseScript(slot))
+            putsUart0("Status: failed to erase script in EEPROM\r\n");
+    }
+    else if(readScript(slot, &scratchScript, tableSignature) != SCRIPT_VALID)
+        putsUart0("\r\nStatus: script was recorded by other firmware, record it again\r\n");
+    else if(isArg(1, "run"))
+        runScript(&scratchScript);
+    else if(isArg(1, "boot"))
+    {
+        if(!setBootScript(slot, tableSignature, &scratchScript))
+            putsUart0("Status: failed to save script to EEPROM\r\n");
+    }
+    else
+        putsUart0("\r\nStatus: invalid \"script\" argument\r\n");
+}
+
+int main(void)
+{
+    uint32_t bootStart, promUs;
+    char bootStr[60];
+    uint8_t slot;
+
+    // Initialize hardware
+	initHw();
+    bootStart = readCycleCounter();     // counter starts in initHw
+
+    // Initialize EEPROM, a few tries before running without it
+    if(initProm())
+        readFromProm();
+    else
+        putsUart0("Status: EEPROM did not initialize, settings not restored\r\n");
+    promUs = (readCycleCounter() - bootStart) / (SYSTEM_CLOCK / 1000000);
+
+	showMenu();
+    // a stale command_data.c still works, just by comparing every name
+    commandHashOk = checkCommandTable(&commandTable);
+    if(!commandHashOk)
+        putsUart0("Status: command slots do not match the table, regenerate command_data.c\r\n");
+    sprintf(bootStr, "Status: boot to prompt %lu us (EEPROM %lu us)\r\n",
+            (unsigned long)((readCycleCounter() - bootStart) / (SYSTEM_CLOCK / 1000000)), (unsigned long)promUs);
+    putsUart0(bootStr);
+
+    // scripts hold command indexes, valid only for the table they were recorded with
+    tableSignature = commandSignature(&commandTable);
+    slot = findBootScript(tableSignature, &scratchScript);
+    if(slot != SCRIPT_NONE && readScript(slot, &scratchScript, tableSignature) == SCRIPT_VALID)
+    {
+        runScript(&scratchScript);
+        fieldCount = 0;
+        memset(tokens, 0, sizeof(tokens));
+        memset(strInput, 0, sizeof(strInput));
+    }
+    while(true)
+    {
+        char str[40];
+        bool status = false;
+        const struct command* command;
+        putsUart0("\r\n");
+        putsUart0("Enter command: ");
+        while(!getsUart0(strInput))
         {
-            if(type[1] == 1)        // second argument is alphabetic
+            uint32_t tripletTime;
+            while(getTimedTriplet(&red, &green, &blue, &tripletTime))
             {
-                deltaFlag = false;  // turn delta mode off
+                profileEnd(PROFILE_LATENCY, tripletTime);
+                if(spcFlag)
+                {
+                    spcTriplet();                 // raw 16-bit samples, summary on request
+                    continue;
+                }
+                if(binaryFlag && !matchFlag && !deltaFlag)
+                {
+                    addFrameTriplet(red, green, blue, tripletTime);    // raw 16-bit samples
+                    continue;
+                }
+                red = TO_8BIT(red);         // 16-bit samples to 8 bits
+                green = TO_8BIT(green);
+                blue = TO_8BIT(blue);
+                processTriplet();
             }
-            else
+
+            if(showActive && anyKeyPressed())
             {
-                deltaFlag = true;
-                iir = 0;            // reset average values
-                D = getValue(1);
+                setRgbColor(0, 0, 0);
+                showActive = false;
             }
-            status = true;
-        }
-        else if(strcmp(cmd, "showcolors") == 0)
-        {
-            showColors();
-            status = true;
-        }
-        else if(strcmp(cmd,"prommenu") == 0)
-        {
-            promMenu();
-            status = true;
-        }
-        else if(strcmp(cmd, "promerase") == 0)
-        {
-            promErase();
-            status = true;
+
+            // encode a full stream buffer and start its transfer
+            streamBackground();
+
+            // compact and blank the color store a word at a time while idle
+            bool storeBusy = colorsBackground();
+
+            // sleep until the next interrupt, masked so a line that completes
+            // after the check still wakes us
+            uint32_t state = disableInterrupts();
+            if(!isRxPending() && !isTripletPending() && !storeBusy && !isStreamReady())
+                waitForInput();
+            restoreInterrupts(state);
         }
-        else if(strcmp(cmd, "promshowcolors") == 0)
+        fieldCount = tokenize(strInput, tokens, MAX_FIELDS);
+        command = NULL;
+        if(fieldCount > 0)
         {
-            promShowColors();
-            status = true;
+            const char* name = &strInput[tokens[0].offset];
+            if(commandHashOk)
+                command = findCommand(&commandTable, name, tokens[0].length);
+            else
+                command = findCommandLinear(&commandTable, name, tokens[0].length);
         }
-        else if(strcmp(cmd, "promcalibration") == 0)
+        if(command != NULL && checkArgs(command->args, fieldCount, tokens))
         {
-            promShowCalibration();
+            if(checkNumbers())
+            {
+                if(recordFlag && command->handler != scriptCommand)
+                    recordStep(command);
+                else if(isStreaming() && command->handler != streamCommand)
+                    putsUart0("\r\nStatus: turn stream mode off first\r\n");
+                else
+                    command->handler();
+            }
             status = true;
         }
 
-
         if(!status){
             putsUart0("\r\n*** Unknown command ***\r\n");
         }
 
         // reset all variables
         fieldCount = 0;
-        memset(pos, 0, MAX_FIELDS*sizeof(uint8_t));
-        memset(type, 0, MAX_FIELDS*sizeof(uint8_t));
-        memset(cmd, 0, 20*sizeof(char));
-        memset(arg, 0, 20*sizeof(char));
+        memset(tokens, 0, sizeof(tokens));
         memset(strInput,0,(MAX_CHARS+1)*sizeof(char));
         memset(str, 0, 40*sizeof(char));
     }
@@ -1,79 +1,68 @@
 #ifndef COLORIMETER_H__
 #define COLORIMETER_H__
 
-#define MAX_CHARS 80        // max number of chars from user input
 #define MAX_FIELDS 5
-#define PUSH_BUTTON1    (*((volatile uint32_t*)(0x42000000 + (0x400253FC - 0x40000000)*32 + 4*4)))
-#define GREEN_LED       (*((volatile uint32_t*)(0x42000000 + (0x400253FC - 0x40000000)*32 + 3*4)))
+#define BAUD_MIN 1200
+#define BAUD_MAX 2500000             // 40 MHz / 16
+#define BAUD_CONFIRM_MS 5000         // host has this long to send "ok" at a new rate
 
 //-----------------------------------------------------------------------------
 // Global variables
 //-----------------------------------------------------------------------------
 
 char strInput[MAX_CHARS+1];          // plus 1 for \0
-char cmd[20];                       // parsed command
-char arg[20];                       // string arument
-uint8_t pos[MAX_FIELDS];            // string_token: start index of each field
-uint8_t type[MAX_FIELDS];           // string_token: 1=alphabet, 2=number
-uint8_t fieldCount;                 // string_token: number of fields
+struct token tokens[MAX_FIELDS];    // fields of strInput, parsed in one pass
+uint8_t fieldCount;                 // fields in the line, may exceed MAX_FIELDS
 uint16_t T;                         // Threshold value (2^n)-1
 uint16_t red;
 uint16_t green;
 uint16_t blue;
-uint32_t colors[16][4];             // columns: valid, red, green, blue
-uint32_t promColors[16][4];
 uint32_t calibration[3];            // redPwm, greenPwm, bluePwm
-uint32_t promCalibration[3];
+uint32_t settleTimes[3];            // learned redUs, greenUs, blueUs
 uint16_t E;                          // match E command
 uint16_t D;                          // delta D command
-float iir;
+uint32_t E2;                         // E squared, compared with squared distances
 bool ledSample;                     // a flag to tell LED interrupt to flash 
 bool matchFlag;                     // match mode indicator
 bool deltaFlag;                     // delta mode indicator
+bool showActive;                    // show N waiting for a key
+bool libraryFlag;                   // match also searches the reference library
+bool binaryFlag;                    // periodic triplets go out as COBS frames
+bool periodicFlag;                  // Timer1A is starting measurements
+bool spcFlag;                       // periodic triplets go into the statistics, not out
+bool commandHashOk;                 // command slots match the table, checked at boot
+bool recordFlag;                    // command lines go into a script instead of running
+uint32_t tableSignature;            // commandSignature(), stamped on scripts
+struct script recording;            // script being recorded
+struct script scratchScript;        // script being run or inspected
+uint16_t sweepSamples[SWEEP_STEPS]; // test/calibrate sweep results
 
 
-//-----------------------------------------------------------------------------
-// Initialize Hardware
-//-----------------------------------------------------------------------------
-
-void initHw();
-
 //-----------------------------------------------------------------------------
 // String/Tokenizing fuctions
 //-----------------------------------------------------------------------------
 
-void putcUart0(char);
-void putsUart0(char*);
-char getcUart0();
-void getsUart0(char*);
-bool ischar(const char);
-bool isNum(const char);
-bool isDelimit(const char);
-void tokenizeStr();
-void parseCmd(uint8_t);
-void parseArg(uint8_t);
+bool isArg(uint8_t, const char*);
 uint16_t getValue(uint8_t);
-bool isCommand(const char*);
+uint32_t getLongValue(uint8_t);
+bool checkNumbers();
 
 //-----------------------------------------------------------------------------
 // EEPROM functions
 //-----------------------------------------------------------------------------
 
 void promMenu();
-uint16_t enableEeprom();
-void saveColorToProm();
 void saveCalibrationToProm();
 void readFromProm();
 void promErase();
 void promShowColors();
+void promStore();
 void promShowCalibration();
 
 //-----------------------------------------------------------------------------
 // Utility functions
 //-----------------------------------------------------------------------------
 
-void setRgbColor(uint16_t, uint16_t, uint16_t);
-uint16_t readAdc0Ss3();
 void waitPb1();
 bool notCalibrated();
 
@@ -81,24 +70,52 @@ bool notCalibrated();
 // Command functions
 //-----------------------------------------------------------------------------
 
+void listCommands(uint8_t, const char*);
 void showMenu();
 void rgbLight();
 void rgbOff();
+void rgbCommand();
 void light();
 void ramp();
 void test();
-void calibrate();
+void calibrate(bool);
+void calibrateCommand();
 void trigger();
 void trigger2();
 void button();
 void periodic();
+void periodicStatus();
 void periodIsr();
+void processTriplet();
 void led();
 void colorN();
 void showN();
 void showColors();
 void eraseN();
 void match();
+void matchCommand();
 void delta();
+void deltaCommand();
+void filterCommand();
+void profile();
+void adcMode();
+void sweepMode();
+void outputMode();
+void spcStatus();
+void spcTriplet();
+void spcCommand();
+void streamStatus();
+void streamCommand();
+void baud();
+void linkTest();
+void uartTx();
+void settle();
+void darkFrame();
+void bench();
+void referenceColors();
+void runScript(const struct script*);
+void recordStep(const struct command*);
+void listScripts();
+void scriptCommand();
 
 #endif
@@ -0,0 +1,298 @@
+// Color functions
+// User color library, packed channel arrays with a validity bitmap
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// The library is one 256-byte image kept in RAM:
+//
+//   word 0       COLOR_MAGIC
+//   words 1-3    validity bitmap, bit n clear = slot n valid (erased = empty)
+//   words 4-23   red[80]
+//   words 24-43  green[80]
+//   words 44-63  blue[80]
+//
+// It is persisted as one-word records in the log store (store.c), one per
+// save or erase, replayed in order at boot:
+//
+//   bits 31-24   slot, with bit 31 set for an erase
+//   bits 23-0    red, green, blue from the low byte up
+//
+// Older firmware mirrored the image word for word at COLOR_ADDRESS, and
+// before that used 16 slots of four words (valid flag 0 or 0xFFFFFFFF, red,
+// green, blue). Either is read when the store is empty and written to it once.
+//
+// Boot only locates the store; the records are replayed into RAM the first
+// time a color is needed.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "eeprom.h"
+#include "store.h"
+#include "colors.h"
+
+#define BITMAP_WORDS    ((COLOR_SLOTS + 31) / 32)
+#define LEGACY_SLOTS    16
+
+#define RECORD_ERASE    0x80000000
+#define RECORD_SLOT(r)  (((r) >> 24) & 0x7F)
+
+struct colorImage
+{
+    uint32_t magic;
+    uint32_t invalid[BITMAP_WORDS];
+    uint8_t red[COLOR_SLOTS];
+    uint8_t green[COLOR_SLOTS];
+    uint8_t blue[COLOR_SLOTS];
+};
+
+#define IMAGE_WORDS     (sizeof(struct colorImage) / 4)
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static struct colorImage image;
+static bool opened = false;                 // EEPROM layout is ours to read and write
+static bool loaded = false;                 // image holds the replayed records
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static uint32_t* imageWords()
+{
+    return (uint32_t*)&image;
+}
+
+static void clearImage()
+{
+    uint8_t i;
+
+    image.magic = COLOR_MAGIC;
+    for (i = 0; i < BITMAP_WORDS; i++)
+        image.invalid[i] = 0xFFFFFFFF;
+    for (i = 0; i < COLOR_SLOTS; i++)
+        image.red[i] = image.green[i] = image.blue[i] = 0;
+}
+
+static void setSlot(uint8_t n, uint8_t red, uint8_t green, uint8_t blue)
+{
+    image.red[n] = red;
+    image.green[n] = green;
+    image.blue[n] = blue;
+    image.invalid[n / 32] &= ~(1UL << (n % 32));
+}
+
+static uint32_t colorRecord(uint8_t n)
+{
+    return ((uint32_t)n << 24) | ((uint32_t)image.blue[n] << 16) | ((uint32_t)image.green[n] << 8) | image.red[n];
+}
+
+static void applyRecord(uint32_t record)
+{
+    uint8_t n = RECORD_SLOT(record);
+
+    if (n >= COLOR_SLOTS)
+        return;
+    if (record & RECORD_ERASE)
+        image.invalid[n / 32] |= 1UL << (n % 32);
+    else
+        setSlot(n, record, record >> 8, record >> 16);
+}
+
+// Live record of slot n for compaction
+static bool snapshotColor(uint16_t n, uint32_t* record)
+{
+    if (!isColorValid(n))
+        return false;
+    *record = colorRecord(n);
+    return true;
+}
+
+// Reads an image written by older firmware, in either layout
+static void loadImage()
+{
+    uint32_t legacy[LEGACY_SLOTS][4];
+    uint8_t i;
+
+    EEPROMRead(imageWords(), COLOR_ADDRESS, sizeof(image));
+    if (image.magic == COLOR_MAGIC)
+        return;
+
+    // image is the 16 slot layout, or erased (all slots invalid either way)
+    for (i = 0; i < LEGACY_SLOTS; i++)
+    {
+        legacy[i][0] = imageWords()[4 * i];
+        legacy[i][1] = imageWords()[4 * i + 1];
+        legacy[i][2] = imageWords()[4 * i + 2];
+        legacy[i][3] = imageWords()[4 * i + 3];
+    }
+    clearImage();
+    for (i = 0; i < LEGACY_SLOTS; i++)
+        if (legacy[i][0] == 0)
+            setSlot(i, legacy[i][1], legacy[i][2], legacy[i][3]);
+}
+
+// Locates the store, converting an older image if it is empty. Returns the
+// number of records waiting to be replayed (or colors converted).
+uint16_t openColors(bool* migrated)
+{
+    *migrated = false;
+    opened = true;
+    loaded = false;
+    storeInit(COLOR_SLOTS, snapshotColor);
+    clearImage();
+    if (isStoreFormatted())
+        return getStoreRecords();
+    loaded = true;
+    loadImage();
+    if (countColors() != 0)
+        *migrated = storeRebuild();
+    else
+        clearImage();
+    return countColors();
+}
+
+// Replays the records on first use
+static void faultIn()
+{
+    uint16_t i;
+
+    if (loaded)
+        return;
+    loaded = true;
+    clearImage();
+    for (i = 0; i < getStoreRecords(); i++)
+        applyRecord(readStoreRecord(i));
+}
+
+bool areColorsLoaded()
+{
+    return loaded;
+}
+
+// Replays the records now instead of on first use, e.g. before the EEPROM
+// holding them is erased
+void loadColors()
+{
+    if (opened)
+        faultIn();
+}
+
+// Forgets the store position after the EEPROM was mass erased; the next save
+// writes the colors still in RAM to a fresh segment. Call loadColors() before
+// the erase, or there is nothing in RAM to keep.
+void resetColorStore()
+{
+    loaded = true;                          // the records are gone, RAM is the copy
+    storeInit(COLOR_SLOTS, snapshotColor);
+}
+
+// Stores slot n and appends its record
+bool saveColor(uint8_t n, uint8_t red, uint8_t green, uint8_t blue)
+{
+    if (n >= COLOR_SLOTS || !opened)
+        return false;
+    faultIn();
+    setSlot(n, red, green, blue);
+    return storeAppend(colorRecord(n));
+}
+
+bool eraseColor(uint8_t n)
+{
+    if (n >= COLOR_SLOTS || !opened)
+        return false;
+    if (!isColorValid(n))
+        return true;
+    image.invalid[n / 32] |= 1UL << (n % 32);
+    return storeAppend(RECORD_ERASE | ((uint32_t)n << 24));
+}
+
+// Runs a step of store compaction; true while there is more to do
+bool colorsBackground()
+{
+    if (!opened)
+        return false;
+    return storeBackground();
+}
+
+bool isColorValid(uint8_t n)
+{
+    faultIn();
+    return n < COLOR_SLOTS && (image.invalid[n / 32] & (1UL << (n % 32))) == 0;
+}
+
+void getColor(uint8_t n, uint8_t* red, uint8_t* green, uint8_t* blue)
+{
+    faultIn();
+    *red = image.red[n];
+    *green = image.green[n];
+    *blue = image.blue[n];
+}
+
+uint8_t countColors()
+{
+    uint8_t i, count = 0;
+
+    for (i = 0; i < COLOR_SLOTS; i++)
+        count += isColorValid(i);
+    return count;
+}
+
+// Valid slots closer than sqrt(e2) to the sample, in slot order; returns how
+// many were stored in hits. Bitmap words with no valid slot are skipped.
+uint8_t matchUserColors(uint16_t red, uint16_t green, uint16_t blue, uint32_t e2, uint8_t* hits)
+{
+    uint32_t valid;
+    uint8_t word, bit, n, found = 0;
+    int32_t dr, dg, db;
+
+    faultIn();
+    for (word = 0; word < BITMAP_WORDS; word++)
+    {
+        valid = ~image.invalid[word];
+        for (bit = 0; valid != 0; bit++, valid >>= 1)
+        {
+            n = word * 32 + bit;
+            if ((valid & 1) == 0 || n >= COLOR_SLOTS)
+                continue;
+            dr = (int32_t)red - image.red[n];
+            dg = (int32_t)green - image.green[n];
+            db = (int32_t)blue - image.blue[n];
+            if ((uint32_t)(dr * dr + dg * dg + db * db) < e2)
+                hits[found++] = n;
+        }
+    }
+    return found;
+}
+
+// Reads slot n straight from the EEPROM records; false if it is not valid there
+bool readPromColor(uint8_t n, uint8_t* red, uint8_t* green, uint8_t* blue)
+{
+    uint32_t record;
+    uint16_t i;
+    bool valid = false;
+
+    if (n >= COLOR_SLOTS || !isStoreFormatted())
+        return false;
+    for (i = 0; i < getStoreRecords(); i++)
+    {
+        record = readStoreRecord(i);
+        if (RECORD_SLOT(record) != n)
+            continue;
+        valid = (record & RECORD_ERASE) == 0;
+        *red = record;
+        *green = record >> 8;
+        *blue = record >> 16;
+    }
+    return valid;
+}
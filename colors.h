@@ -0,0 +1,38 @@
+// Color functions
+// User color library, packed channel arrays with a validity bitmap
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef COLORS_H_
+#define COLORS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define COLOR_SLOTS     80
+#define COLOR_MAGIC     0x434C5231  // "CLR1", packed layout
+#define COLOR_ADDRESS   0x0         // EEPROM byte address of images from older firmware
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint16_t openColors(bool* migrated);
+bool areColorsLoaded();
+void loadColors();
+bool saveColor(uint8_t n, uint8_t red, uint8_t green, uint8_t blue);
+bool eraseColor(uint8_t n);
+void resetColorStore();
+bool colorsBackground();
+bool isColorValid(uint8_t n);
+void getColor(uint8_t n, uint8_t* red, uint8_t* green, uint8_t* blue);
+uint8_t countColors();
+uint8_t matchUserColors(uint16_t red, uint16_t green, uint16_t blue, uint32_t e2, uint8_t* hits);
+bool readPromColor(uint8_t n, uint8_t* red, uint8_t* green, uint8_t* blue);
+
+#endif
@@ -0,0 +1,121 @@
+// Command functions
+// Command table with perfect-hash lookup and argument schemas
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// The table itself is generated by tools/mkcommands from commands.csv, which
+// searches for a multiplier that sends every name to its own slot. A lookup
+// is one hash of the name, one slot read and one strcmp to reject names that
+// are not commands, however many commands there are.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "crc.h"
+#include "command.h"
+
+#define FNV_BASIS   2166136261u
+#define FNV_PRIME   16777619u
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// FNV-1a of the first length characters of name, then multiply-shift into
+// a slot number
+uint8_t commandHash(const char* name, uint8_t length, uint32_t multiplier)
+{
+    uint32_t h = FNV_BASIS;
+
+    while(length-- > 0)
+        h = (h ^ (uint8_t)*name++) * FNV_PRIME;
+    return (h * multiplier) >> (32 - COMMAND_SLOT_BITS);
+}
+
+// True if the length characters at name are the whole of command's name
+static bool isName(const struct command* command, const char* name, uint8_t length)
+{
+    return strncmp(command->name, name, length) == 0 && command->name[length] == '\0';
+}
+
+// Command whose name is the length characters at name, or NULL
+const struct command* findCommand(const struct commandTable* table, const char* name, uint8_t length)
+{
+    uint8_t slot = table->slot[commandHash(name, length, table->multiplier)];
+    const struct command* command;
+
+    if(slot == 0)
+        return NULL;
+    command = &table->commands[slot - 1];
+    return isName(command, name, length) ? command : NULL;
+}
+
+// Same result by comparing every name, used when the slots do not check out
+const struct command* findCommandLinear(const struct commandTable* table, const char* name, uint8_t length)
+{
+    uint8_t i;
+
+    for(i = 0; i < table->count; i++)
+        if(isName(&table->commands[i], name, length))
+            return &table->commands[i];
+    return NULL;
+}
+
+// True if every command is found through its slot, so the slots were
+// generated from this list
+bool checkCommandTable(const struct commandTable* table)
+{
+    uint8_t i;
+
+    for(i = 0; i < table->count; i++)
+    {
+        const char* name = table->commands[i].name;
+        if(findCommand(table, name, strlen(name)) != &table->commands[i])
+            return false;
+    }
+    return true;
+}
+
+// True if the fields after the command match one of the forms in args
+bool checkArgs(const char* args, uint8_t fieldCount, const struct token* tokens)
+{
+    uint8_t i;
+
+    while(true)
+    {
+        for(i = 1; *args != '|' && *args != '\0'; args++, i++)
+        {
+            if(i >= fieldCount || (*args == 'n' && tokens[i].kind != TOKEN_NUMBER)
+                    || (*args == 'a' && tokens[i].kind != TOKEN_ALPHA))
+                break;
+        }
+        if((*args == '|' || *args == '\0') && i == fieldCount)
+            return true;
+        while(*args != '|' && *args != '\0')
+            args++;
+        if(*args == '\0')
+            return false;
+        args++;
+    }
+}
+
+// CRC of the names in table order, so data that stores command indexes can
+// tell whether it was written against this table
+uint32_t commandSignature(const struct commandTable* table)
+{
+    uint32_t crc = 0;
+    uint8_t i;
+
+    for(i = 0; i < table->count; i++)
+        crc = crc32(crc, table->commands[i].name, strlen(table->commands[i].name) + 1);
+    return crc;
+}
@@ -0,0 +1,60 @@
+// Command functions
+// Command table with perfect-hash lookup and argument schemas
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef COMMAND_H_
+#define COMMAND_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "token.h"
+
+#define COMMAND_SLOT_BITS   7
+#define COMMAND_SLOTS       (1 << COMMAND_SLOT_BITS)
+#define COMMAND_MAX         (COMMAND_SLOTS / 2)     // keeps a multiplier easy to find
+#define COMMAND_HIDDEN      0       // menu a command is listed in
+#define COMMAND_MAIN        1
+#define COMMAND_PROM        2
+
+// args lists the accepted argument forms separated by '|', one character per
+// argument: n numeric, a alphabetic, * either. "" is no arguments, so "|n"
+// takes none or one number. slot[] holds 1 + the index of the command whose
+// name hashes there, 0 for an empty slot.
+struct command
+{
+    const char* name;
+    void (*handler)();
+    const char* args;
+    const char* usage;
+    const char* help;
+    uint8_t menu;
+};
+
+struct commandTable
+{
+    const struct command* commands;
+    const uint8_t* slot;
+    uint32_t multiplier;
+    uint8_t count;
+};
+
+extern const struct commandTable commandTable;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint8_t commandHash(const char* name, uint8_t length, uint32_t multiplier);
+const struct command* findCommand(const struct commandTable* table, const char* name, uint8_t length);
+const struct command* findCommandLinear(const struct commandTable* table, const char* name, uint8_t length);
+bool checkCommandTable(const struct commandTable* table);
+bool checkArgs(const char* args, uint8_t fieldCount, const struct token* tokens);
+uint32_t commandSignature(const struct commandTable* table);
+
+#endif
@@ -0,0 +1,173 @@
+// Command table
+// Generated by tools/mkcommands from commands.csv, do not edit
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "command.h"
+
+void showMenu();
+void rgbCommand();
+void light();
+void ramp();
+void test();
+void calibrateCommand();
+void trigger();
+void button();
+void led();
+void periodic();
+void deltaCommand();
+void filterCommand();
+void matchCommand();
+void colorN();
+void showN();
+void eraseN();
+void showColors();
+void adcMode();
+void sweepMode();
+void settle();
+void darkFrame();
+void referenceColors();
+void bench();
+void profile();
+void outputMode();
+void spcCommand();
+void streamCommand();
+void baud();
+void linkTest();
+void uartTx();
+void scriptCommand();
+void promMenu();
+void promShowCalibration();
+void promShowColors();
+void promErase();
+void promStore();
+
+// 37 commands
+static const struct command commands[37] =
+{
+    {"help", showMenu, "",
+        "help",
+        "show main menu", COMMAND_MAIN},
+    {"menu", showMenu, "",
+        "menu",
+        "show main menu", COMMAND_HIDDEN},
+    {"rgb", rgbCommand, "nnn|a",
+        "rgb [#] [#] [#]|off",
+        "changes rgb to specified value or turns it off", COMMAND_MAIN},
+    {"light", light, "",
+        "light",
+        "measures light intensity", COMMAND_MAIN},
+    {"ramp", ramp, "aaa",
+        "ramp red|green|blue",
+        "ramps up each rgb", COMMAND_MAIN},
+    {"test", test, "",
+        "test",
+        "ramps and measures all rgb values", COMMAND_MAIN},
+    {"calibrate", calibrateCommand, "|a",
+        "calibrate [linear]",
+        "gets redPwm, greenPwm, and bluePwm values", COMMAND_MAIN},
+    {"trigger", trigger, "",
+        "trigger",
+        "turns on led light calibrated rgb and displays R values", COMMAND_MAIN},
+    {"button", button, "",
+        "button",
+        "uses SW1 to perform trigger function", COMMAND_MAIN},
+    {"led", led, "*",
+        "led x",
+        "x = on, off, or sample", COMMAND_MAIN},
+    {"periodic", periodic, "*",
+        "periodic T",
+        "T = 0 - 255 or off", COMMAND_MAIN},
+    {"delta", deltaCommand, "*",
+        "delta D",
+        "D = 0 - 255 or off", COMMAND_MAIN},
+    {"filter", filterCommand, "|a|an",
+        "filter [ema|mean|median|change N|off]",
+        "delta filter pipeline: ema gain %, mean/median samples, change counts", COMMAND_MAIN},
+    {"match", matchCommand, "n|a",
+        "match E",
+        "E = 0 - 255 or off", COMMAND_MAIN},
+    {"color", colorN, "n",
+        "color N",
+        "saves the current color as color N", COMMAND_MAIN},
+    {"show", showN, "n",
+        "show N",
+        "shows color N on the rgb until a key is pressed", COMMAND_MAIN},
+    {"erase", eraseN, "n",
+        "erase N",
+        "erases color N", COMMAND_MAIN},
+    {"showcolors", showColors, "",
+        "showColors",
+        "shows colors saved", COMMAND_MAIN},
+    {"adc", adcMode, "|nn",
+        "adc [avg] [burst]",
+        "hw averaging 1-64x, 1-8 samples per led", COMMAND_MAIN},
+    {"sweep", sweepMode, "|n",
+        "sweep [us]",
+        "settle time per point for test and calibrate", COMMAND_MAIN},
+    {"settle", settle, "|a|an",
+        "settle [fixed|learned|adaptive] [tol]",
+        "led settle before each sample", COMMAND_MAIN},
+    {"dark", darkFrame, "|*",
+        "dark [N|reset]",
+        "subtract ambient, refreshed every N triplets", COMMAND_MAIN},
+    {"library", referenceColors, "|a",
+        "library [on|off]",
+        "reference shades in flash, searched by match", COMMAND_MAIN},
+    {"bench", bench, "a|an",
+        "bench distance|library|packed|fmt|tokens [n]",
+        "kernel cycles per sample against the originals", COMMAND_MAIN},
+    {"profile", profile, "|a",
+        "profile [reset]",
+        "time spent in each measurement and reporting phase", COMMAND_MAIN},
+    {"output", outputMode, "|a|an",
+        "output [text|binary] [batch]",
+        "periodic triplets as text or COBS frames of 1-8", COMMAND_MAIN},
+    {"spc", spcCommand, "|a|an|ann",
+        "spc [on [window] [subgroup]|off]",
+        "periodic statistics and X-bar/R alarms kept on the device", COMMAND_MAIN},
+    {"stream", streamCommand, "|a",
+        "stream [on|off]",
+        "back-to-back measurements as binary frames sent by uDMA", COMMAND_MAIN},
+    {"baud", baud, "|n",
+        "baud [N]",
+        "switch rate, reverts unless \"ok\" is sent within 5 s", COMMAND_MAIN},
+    {"linktest", linkTest, "|n|a|an",
+        "linktest [echo] [bytes]",
+        "uart throughput and errors at this rate: loopback or echoed by the host", COMMAND_MAIN},
+    {"uart", uartTx, "|a",
+        "uart [block|newest|oldest]",
+        "uart buffer status, tx policy when full", COMMAND_MAIN},
+    {"script", scriptCommand, "|a|aa",
+        "script [record|run|erase|boot name|end]",
+        "command sequences kept in EEPROM", COMMAND_MAIN},
+    {"prommenu", promMenu, "",
+        "promMenu",
+        "EEPROM commands", COMMAND_MAIN},
+    {"promcalibration", promShowCalibration, "",
+        "promCalibration",
+        "shows calibrated rgb values", COMMAND_PROM},
+    {"promshowcolors", promShowColors, "",
+        "promShowColors",
+        "lists valid colors in EEPROM", COMMAND_PROM},
+    {"promerase", promErase, "",
+        "promErase",
+        "erases EEPROM to factory default", COMMAND_PROM},
+    {"promstore", promStore, "",
+        "promStore",
+        "color record store segments, writes and save latency", COMMAND_PROM},
+};
+
+static const uint8_t commandSlot[COMMAND_SLOTS] =
+{
+    0, 0, 0, 0, 0, 28, 0, 0, 0, 35, 0, 0, 0, 0, 0, 29,
+    0, 0, 0, 0, 26, 17, 0, 0, 33, 0, 1, 0, 20, 0, 0, 0,
+    0, 5, 0, 24, 0, 0, 0, 8, 0, 0, 0, 0, 0, 0, 0, 15,
+    9, 11, 31, 0, 0, 0, 0, 0, 0, 3, 19, 0, 0, 0, 21, 0,
+    0, 0, 0, 34, 2, 0, 0, 0, 0, 12, 0, 0, 0, 0, 0, 22,
+    0, 0, 0, 23, 4, 6, 16, 0, 0, 0, 0, 0, 0, 0, 27, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 13, 0, 0, 18, 7, 30, 32,
+    0, 0, 37, 36, 0, 25, 14, 0, 0, 0, 0, 0, 0, 0, 10, 0,
+};
+
+const struct commandTable commandTable = {commands, commandSlot, 0x9DA9DF8Bu, 37};
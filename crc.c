@@ -0,0 +1,50 @@
+// CRC functions
+// CRC-32 for EEPROM sections and serial frames
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// CRC-32 (IEEE 802.3, reflected, as in zlib), a nibble at a time from a
+// 16-entry table: 64 bytes of flash instead of 1 KB for a byte table.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include "crc.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static const uint32_t crcTable[16] =
+{
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Continues crc over length bytes; start with 0
+uint32_t crc32(uint32_t crc, const void* data, uint32_t length)
+{
+    const uint8_t* p = data;
+
+    crc = ~crc;
+    while (length--)
+    {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ crcTable[crc & 15];
+        crc = (crc >> 4) ^ crcTable[crc & 15];
+    }
+    return ~crc;
+}
@@ -0,0 +1,22 @@
+// CRC functions
+// CRC-32 for EEPROM sections and serial frames
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef CRC_H_
+#define CRC_H_
+
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint32_t crc32(uint32_t crc, const void* data, uint32_t length);
+
+#endif
@@ -0,0 +1,300 @@
+// Distance functions
+// Fixed-point color distance for match and delta
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// match compares squared integer distances with E^2, which gives the same
+// answer as sqrt(d^2) < E without any floating point: both sides are
+// integers, and an integer below E^2 has a root below E.
+//
+// delta needs the magnitude itself, so it takes an integer square root in Q4
+// and keeps the IIR average in Q16 with a Q15 gain. The average moves by
+// (v - iir) * 0.1 each sample like the float version; the remaining difference
+// is rounding, well below one count.
+//
+// Library scans work on packed 0x00BBGGRR words. With the Cortex-M4 DSP
+// extension, USADA8 gives the sum of absolute differences of a whole entry in
+// one instruction. Since |d|^2 <= sad^2 <= 3|d|^2, sad alone accepts an entry
+// when sad^2 < E^2 and rejects it when sad^2 >= 3E^2; only the entries in
+// between take the exact squared distance, with SSUB16 on the red/blue and
+// green halfwords and SMLAD for the sums of squares. The C versions compute
+// the exact distance of every entry and give the same results on any host.
+//
+// updateDeltaExact() is the delta arithmetic written out plainly, with a
+// search for the root and a floor division for the gain, so the bench can
+// hold updateDelta() to it bit for bit; the float version only shows how far
+// the fixed-point average is from the original.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+#if defined(__ARM_FEATURE_DSP)
+#include <arm_acle.h>
+#endif
+#include "distance.h"
+
+#define IIR_FRAC        16
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static int32_t iir = 0;                     // delta average magnitude, Q16
+static float iirReference = 0;
+static int64_t iirExact = 0;                // Q16
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Floor of the square root, bit by bit (16 iterations, no divide)
+uint32_t isqrt32(uint32_t x)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > x)
+        bit >>= 2;
+    while (bit != 0)
+    {
+        if (x >= root + bit)
+        {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+            root >>= 1;
+        bit >>= 2;
+    }
+    return root;
+}
+
+// Squared distance to a library entry (valid, red, green, blue)
+uint32_t squaredDistance(uint16_t red, uint16_t green, uint16_t blue, const uint32_t* color)
+{
+    int32_t dr = (int32_t)red - (int32_t)color[1];
+    int32_t dg = (int32_t)green - (int32_t)color[2];
+    int32_t db = (int32_t)blue - (int32_t)color[3];
+
+    return dr * dr + dg * dg + db * db;
+}
+
+// Returns a bit per valid entry (valid word 0) closer than sqrt(e2)
+uint16_t matchColors(uint16_t red, uint16_t green, uint16_t blue, const uint32_t colors[][4],
+                     uint8_t count, uint32_t e2)
+{
+    uint16_t matches = 0;
+    uint8_t i;
+
+    for (i = 0; i < count; i++)
+        if (colors[i][0] == 0 && squaredDistance(red, green, blue, colors[i]) < e2)
+            matches |= 1 << i;
+    return matches;
+}
+
+uint32_t squaredDistancePackedC(uint32_t a, uint32_t b)
+{
+    int32_t dr = (int32_t)PACKED_RED(a) - (int32_t)PACKED_RED(b);
+    int32_t dg = (int32_t)PACKED_GREEN(a) - (int32_t)PACKED_GREEN(b);
+    int32_t db = (int32_t)PACKED_BLUE(a) - (int32_t)PACKED_BLUE(b);
+
+    return dr * dr + dg * dg + db * db;
+}
+
+#if defined(__ARM_FEATURE_DSP)
+
+uint32_t squaredDistancePacked(uint32_t a, uint32_t b)
+{
+    int16x2_t rb = __ssub16(__uxtb16(a), __uxtb16(b));              // red, blue
+    int16x2_t g = __ssub16(__uxtb16(a >> 8), __uxtb16(b >> 8));     // green, 0
+
+    return __smlad(rb, rb, __smuad(g, g));
+}
+
+// Finds the colors closer than sqrt(e2) to sample; stores up to maxHits of
+// their indexes and returns the total. The SAD test rejects only when
+// sad^2 >= 3 e2, saturated since e2 goes up to 65535^2.
+uint16_t scanPacked(const uint32_t* colors, uint16_t count, uint32_t sample, uint32_t e2,
+                    uint16_t* hits, uint16_t maxHits)
+{
+    uint32_t reject = e2 > 0xFFFFFFFF / 3 ? 0xFFFFFFFF : e2 * 3;
+    uint32_t sad, sad2;
+    uint16_t found = 0;
+    uint16_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        sad = __usad8(colors[i], sample);
+        sad2 = sad * sad;
+        if (sad2 >= reject)
+            continue;
+        if (sad2 < e2 || squaredDistancePacked(colors[i], sample) < e2)
+        {
+            if (found < maxHits)
+                hits[found] = i;
+            found++;
+        }
+    }
+    return found;
+}
+
+const char* getPackedKernel()
+{
+    return "dsp";
+}
+
+#else
+
+uint32_t squaredDistancePacked(uint32_t a, uint32_t b)
+{
+    return squaredDistancePackedC(a, b);
+}
+
+uint16_t scanPacked(const uint32_t* colors, uint16_t count, uint32_t sample, uint32_t e2,
+                    uint16_t* hits, uint16_t maxHits)
+{
+    return scanPackedC(colors, count, sample, e2, hits, maxHits);
+}
+
+const char* getPackedKernel()
+{
+    return "c";
+}
+
+#endif
+
+uint16_t scanPackedC(const uint32_t* colors, uint16_t count, uint32_t sample, uint32_t e2,
+                     uint16_t* hits, uint16_t maxHits)
+{
+    uint16_t found = 0;
+    uint16_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (squaredDistancePackedC(colors[i], sample) < e2)
+        {
+            if (found < maxHits)
+                hits[found] = i;
+            found++;
+        }
+    }
+    return found;
+}
+
+void resetDelta()
+{
+    iir = 0;
+}
+
+// Updates the average magnitude and returns true if this sample differs from
+// it by more than d
+bool updateDelta(uint16_t red, uint16_t green, uint16_t blue, uint16_t d)
+{
+    uint32_t sum = (uint32_t)red * red + (uint32_t)green * green + (uint32_t)blue * blue;
+    int32_t v = isqrt32(sum << (2 * MAGNITUDE_FRAC)) << (IIR_FRAC - MAGNITUDE_FRAC);
+    int32_t diff;
+
+    iir += (int32_t)(((int64_t)(v - iir) * DELTA_GAIN_Q15 + (1 << 14)) >> 15);
+    diff = v - iir;
+    if (diff < 0)
+        diff = -diff;
+    return (uint32_t)diff > ((uint32_t)d << IIR_FRAC);
+}
+
+// Average magnitude, Q16
+int32_t getDeltaAverage()
+{
+    return iir;
+}
+
+uint16_t matchColorsReference(uint16_t red, uint16_t green, uint16_t blue, const uint32_t colors[][4],
+                              uint8_t count, uint16_t e)
+{
+    float Ei;
+    uint8_t i;
+    uint16_t reds, greens, blues;
+    uint16_t matches = 0;
+
+    for (i = 0; i < count; i++)
+    {
+        if (colors[i][0] == 0)
+        {
+            reds = abs(red - colors[i][1]);
+            greens = abs(green - colors[i][2]);
+            blues = abs(blue - colors[i][3]);
+            reds = pow(reds, 2);
+            greens = pow(greens, 2);
+            blues = pow(blues, 2);
+            Ei = sqrt(reds + greens + blues);
+            if (Ei < e)
+                matches |= 1 << i;
+        }
+    }
+    return matches;
+}
+
+void resetDeltaReference()
+{
+    iirReference = 0;
+}
+
+bool updateDeltaReference(uint16_t red, uint16_t green, uint16_t blue, uint16_t d)
+{
+    float v;
+    float alpha = 0.9;
+
+    v = sqrt(pow(red, 2) + pow(green, 2) + pow(blue, 2));
+    iirReference = (alpha * iirReference) + (1 - alpha) * v;
+    return fabs(v - iirReference) > d;
+}
+
+void resetDeltaExact()
+{
+    iirExact = 0;
+}
+
+// Same arithmetic as updateDelta(): m = floor(sqrt(sum x 2^8)) in Q4,
+// v = m x 2^12 in Q16, iir += floor(((v - iir) x 3277 + 2^14) / 2^15),
+// changed when |v - iir| > d x 2^16
+bool updateDeltaExact(uint16_t red, uint16_t green, uint16_t blue, uint16_t d)
+{
+    uint64_t sum = (uint64_t)red * red + (uint64_t)green * green + (uint64_t)blue * blue;
+    uint64_t scaled = sum << (2 * MAGNITUDE_FRAC);
+    uint64_t low = 0, high = (uint64_t)1 << 21, mid;
+    int64_t v, step, diff;
+
+    while (high - low > 1)
+    {
+        mid = (low + high) / 2;
+        if (mid * mid <= scaled)
+            low = mid;
+        else
+            high = mid;
+    }
+    v = (int64_t)low << (IIR_FRAC - MAGNITUDE_FRAC);
+    step = (v - iirExact) * DELTA_GAIN_Q15 + (1 << 14);
+    if (step >= 0)
+        step = step / 32768;
+    else
+        step = -((-step + 32767) / 32768);
+    iirExact += step;
+    diff = v - iirExact;
+    if (diff < 0)
+        diff = -diff;
+    return diff > (int64_t)d * 65536;
+}
+
+int32_t getDeltaExactAverage()
+{
+    return iirExact;
+}
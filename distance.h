@@ -0,0 +1,57 @@
+// Distance functions
+// Fixed-point color distance for match and delta
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef DISTANCE_H_
+#define DISTANCE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DELTA_GAIN_Q15  3277        // 1 - alpha, alpha = 0.9
+#define MAGNITUDE_FRAC  4           // magnitude in Q4, components below 2365
+
+// Packed 8-bit color word 0x00BBGGRR, components above 255 saturate
+#define PACK_RGB(r, g, b)   ((uint32_t)((r) > 255 ? 255 : (r)) | ((uint32_t)((g) > 255 ? 255 : (g)) << 8) \
+                            | ((uint32_t)((b) > 255 ? 255 : (b)) << 16))
+#define PACKED_RED(c)       ((c) & 0xFF)
+#define PACKED_GREEN(c)     (((c) >> 8) & 0xFF)
+#define PACKED_BLUE(c)      (((c) >> 16) & 0xFF)
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint32_t isqrt32(uint32_t x);
+uint32_t squaredDistance(uint16_t red, uint16_t green, uint16_t blue, const uint32_t* color);
+uint16_t matchColors(uint16_t red, uint16_t green, uint16_t blue, const uint32_t colors[][4],
+                     uint8_t count, uint32_t e2);
+uint32_t squaredDistancePacked(uint32_t a, uint32_t b);
+uint32_t squaredDistancePackedC(uint32_t a, uint32_t b);
+uint16_t scanPacked(const uint32_t* colors, uint16_t count, uint32_t sample, uint32_t e2,
+                    uint16_t* hits, uint16_t maxHits);
+uint16_t scanPackedC(const uint32_t* colors, uint16_t count, uint32_t sample, uint32_t e2,
+                     uint16_t* hits, uint16_t maxHits);
+const char* getPackedKernel();
+void resetDelta();
+bool updateDelta(uint16_t red, uint16_t green, uint16_t blue, uint16_t d);
+int32_t getDeltaAverage();
+
+// Original floating point versions, kept as the reference for the bench
+uint16_t matchColorsReference(uint16_t red, uint16_t green, uint16_t blue, const uint32_t colors[][4],
+                              uint8_t count, uint16_t e);
+void resetDeltaReference();
+bool updateDeltaReference(uint16_t red, uint16_t green, uint16_t blue, uint16_t d);
+
+// Plain integer model of the fixed-point delta, bit for bit
+void resetDeltaExact();
+bool updateDeltaExact(uint16_t red, uint16_t green, uint16_t blue, uint16_t d);
+int32_t getDeltaExactAverage();
+
+#endif
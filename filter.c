@@ -0,0 +1,279 @@
+// Filter functions
+// Fixed-point filter pipeline for the delta sample path
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Up to FILTER_STAGES stages run in order on each red, green, blue sample,
+// every channel on its own, and pass whole counts from one stage to the next:
+//
+//   ema     y += (x - y) x gain, y in Q16, gain in Q15 (1 - alpha)
+//   mean    running sum of the last n samples
+//   median  middle of the last n samples, insertion sorted (n <= 9)
+//   change  flags a channel that moved more than d counts, either way, from
+//           where it was when it was last flagged
+//
+// If no stage is a change detector, one with the delta threshold runs after
+// the others. Each stage is timed with readCpuCycles(), so the cost of a
+// pipeline can be weighed against how quickly it responds.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hal.h"
+#include "filter.h"
+
+#define EMA_FRAC        16
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static uint8_t stageType[FILTER_STAGES];
+static uint16_t stageParameter[FILTER_STAGES];
+static uint16_t stageGain[FILTER_STAGES];   // ema, Q15
+static uint8_t stages = 0;
+
+static int32_t emaState[FILTER_STAGES][3];  // Q16
+static uint16_t history[FILTER_STAGES][3][FILTER_MEAN_MAX];
+static uint32_t historySum[FILTER_STAGES][3];
+static uint8_t historyNext[FILTER_STAGES];
+static uint8_t historyCount[FILTER_STAGES];
+static uint16_t changeReference[FILTER_STAGES + 1][3];  // plus the implicit detector
+static bool primed[FILTER_STAGES + 1];      // first sample seen since the reset
+
+static uint32_t stageCycles[FILTER_STAGES + 1];
+static uint32_t stageMaxCycles[FILTER_STAGES + 1];
+static uint32_t stageCalls[FILTER_STAGES + 1];
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Appends a stage; false if the pipeline is full or the parameter is out of
+// range
+bool addFilter(uint8_t type, uint16_t parameter)
+{
+    if (stages == FILTER_STAGES)
+        return false;
+    switch (type)
+    {
+    case FILTER_EMA:
+        if (parameter < 1 || parameter > 100)
+            return false;
+        stageGain[stages] = ((uint32_t)parameter << 15) / 100;
+        break;
+    case FILTER_MEAN:
+        if (parameter < 2 || parameter > FILTER_MEAN_MAX)
+            return false;
+        break;
+    case FILTER_MEDIAN:
+        if (parameter < 3 || parameter > FILTER_MEDIAN_MAX || (parameter & 1) == 0)
+            return false;
+        break;
+    case FILTER_CHANGE:
+        break;
+    default:
+        return false;
+    }
+    stageType[stages] = type;
+    stageParameter[stages] = parameter;
+    stages++;
+    resetFilters();
+    return true;
+}
+
+// Empties the pipeline; delta goes back to the magnitude average
+void clearFilters()
+{
+    stages = 0;
+    resetFilters();
+}
+
+// Forgets the samples seen so far and the cycle counts
+void resetFilters()
+{
+    uint8_t i;
+
+    for (i = 0; i <= FILTER_STAGES; i++)
+    {
+        if (i < FILTER_STAGES)
+        {
+            historyNext[i] = historyCount[i] = 0;
+            historySum[i][0] = historySum[i][1] = historySum[i][2] = 0;
+        }
+        primed[i] = false;
+        stageCycles[i] = stageMaxCycles[i] = stageCalls[i] = 0;
+    }
+}
+
+uint8_t getFilterCount()
+{
+    return stages;
+}
+
+uint8_t getFilterType(uint8_t stage)
+{
+    return stage < stages ? stageType[stage] : FILTER_CHANGE;
+}
+
+uint16_t getFilterParameter(uint8_t stage)
+{
+    return stage < stages ? stageParameter[stage] : 0;
+}
+
+// Cycles per sample of a stage; stage getFilterCount() is the implicit change
+// detector
+void getFilterCycles(uint8_t stage, uint32_t* average, uint32_t* max)
+{
+    *average = stageCalls[stage] ? stageCycles[stage] / stageCalls[stage] : 0;
+    *max = stageMaxCycles[stage];
+}
+
+const char* getFilterName(uint8_t type)
+{
+    static const char* names[] = {"none", "ema", "mean", "median", "change"};
+    return type <= FILTER_CHANGE ? names[type] : "?";
+}
+
+static void runEma(uint8_t stage, uint16_t* rgb)
+{
+    int32_t* y = emaState[stage];
+    uint8_t i;
+
+    for (i = 0; i < 3; i++)
+    {
+        if (!primed[stage])
+            y[i] = (int32_t)rgb[i] << EMA_FRAC;
+        else
+            y[i] += (int32_t)(((int64_t)(((int32_t)rgb[i] << EMA_FRAC) - y[i]) * stageGain[stage] + (1 << 14)) >> 15);
+        rgb[i] = (y[i] + (1 << (EMA_FRAC - 1))) >> EMA_FRAC;
+    }
+    primed[stage] = true;
+}
+
+// Stores the sample in the stage's history, the oldest dropping out
+static void remember(uint8_t stage, const uint16_t* rgb)
+{
+    uint8_t n = stageParameter[stage], slot = historyNext[stage];
+    uint8_t i;
+
+    for (i = 0; i < 3; i++)
+    {
+        if (historyCount[stage] == n)
+            historySum[stage][i] -= history[stage][i][slot];
+        history[stage][i][slot] = rgb[i];
+        historySum[stage][i] += rgb[i];
+    }
+    historyNext[stage] = (slot + 1) % n;
+    if (historyCount[stage] < n)
+        historyCount[stage]++;
+}
+
+static void runMean(uint8_t stage, uint16_t* rgb)
+{
+    uint8_t count, i;
+
+    remember(stage, rgb);
+    count = historyCount[stage];
+    for (i = 0; i < 3; i++)
+        rgb[i] = (historySum[stage][i] + count / 2) / count;
+}
+
+// Until the history is full, the median of what there is (the upper middle
+// for an even count)
+static void runMedian(uint8_t stage, uint16_t* rgb)
+{
+    uint16_t sorted[FILTER_MEDIAN_MAX], v;
+    uint8_t count, i, j, k;
+
+    remember(stage, rgb);
+    count = historyCount[stage];
+    for (i = 0; i < 3; i++)
+    {
+        for (j = 0; j < count; j++)
+        {
+            v = history[stage][i][j];
+            for (k = j; k > 0 && sorted[k - 1] > v; k--)
+                sorted[k] = sorted[k - 1];
+            sorted[k] = v;
+        }
+        rgb[i] = sorted[count / 2];
+    }
+}
+
+static uint8_t runChange(uint8_t stage, const uint16_t* rgb, uint16_t d, int16_t* steps)
+{
+    uint16_t* reference = changeReference[stage];
+    uint8_t changed = 0, i;
+    int32_t step;
+
+    for (i = 0; i < 3; i++)
+    {
+        if (!primed[stage])
+            reference[i] = rgb[i];
+        step = (int32_t)rgb[i] - reference[i];
+        if (step > d || step < -(int32_t)d)
+        {
+            changed |= 1 << i;
+            steps[i] = step;
+            reference[i] = rgb[i];
+        }
+    }
+    primed[stage] = true;
+    return changed;
+}
+
+static void countCycles(uint8_t stage, uint32_t cycles)
+{
+    stageCycles[stage] += cycles;
+    stageCalls[stage]++;
+    if (cycles > stageMaxCycles[stage])
+        stageMaxCycles[stage] = cycles;
+}
+
+// Filters a sample in place; returns the changed channels (FILTER_RED ...) and
+// their signed steps. d is the threshold of the implicit change detector.
+uint8_t runFilters(uint16_t* rgb, uint16_t d, int16_t* steps)
+{
+    uint8_t changed = 0, i;
+    bool detector = false;
+    uint32_t start;
+
+    steps[0] = steps[1] = steps[2] = 0;
+    for (i = 0; i < stages; i++)
+    {
+        start = readCpuCycles();
+        switch (stageType[i])
+        {
+        case FILTER_EMA:
+            runEma(i, rgb);
+            break;
+        case FILTER_MEAN:
+            runMean(i, rgb);
+            break;
+        case FILTER_MEDIAN:
+            runMedian(i, rgb);
+            break;
+        case FILTER_CHANGE:
+            changed |= runChange(i, rgb, stageParameter[i], steps);
+            detector = true;
+            break;
+        }
+        countCycles(i, readCpuCycles() - start);
+    }
+    if (!detector)
+    {
+        start = readCpuCycles();
+        changed = runChange(stages, rgb, d, steps);
+        countCycles(stages, readCpuCycles() - start);
+    }
+    return changed;
+}
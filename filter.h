@@ -0,0 +1,46 @@
+// Filter functions
+// Fixed-point filter pipeline for the delta sample path
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef FILTER_H_
+#define FILTER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FILTER_STAGES   4           // stages in the pipeline
+#define FILTER_MEAN_MAX 16          // moving average length
+#define FILTER_MEDIAN_MAX 9         // median length, odd
+
+#define FILTER_NONE     0
+#define FILTER_EMA      1           // parameter: gain 1 - alpha in percent, 1-100
+#define FILTER_MEAN     2           // parameter: samples, 2 - FILTER_MEAN_MAX
+#define FILTER_MEDIAN   3           // parameter: samples, odd, 3 - FILTER_MEDIAN_MAX
+#define FILTER_CHANGE   4           // parameter: counts a channel must move
+
+// Changed channels, as returned by runFilters()
+#define FILTER_RED      0x01
+#define FILTER_GREEN    0x02
+#define FILTER_BLUE     0x04
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+bool addFilter(uint8_t type, uint16_t parameter);
+void clearFilters();
+void resetFilters();
+uint8_t getFilterCount();
+uint8_t getFilterType(uint8_t stage);
+uint16_t getFilterParameter(uint8_t stage);
+void getFilterCycles(uint8_t stage, uint32_t* average, uint32_t* max);
+const char* getFilterName(uint8_t type);
+uint8_t runFilters(uint16_t* rgb, uint16_t d, int16_t* steps);
+
+#endif
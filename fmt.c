@@ -0,0 +1,114 @@
+// Format functions
+// Integer and RGB triplet formatting without printf
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Each routine writes at p, terminates the string and returns a pointer to the
+// terminator, so calls chain to build a line in place:
+//
+//   p = fmtString(str, "Color ");
+//   p = fmtUnsigned(p, n);
+//   fmtString(p, "\r\n");
+//
+// Digits are produced two at a time from a 200-byte table, one divide by 100
+// per pair. The output matches sprintf's %u, and %<width>u for fmtPadded
+// with a ' ' pad.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include "fmt.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static const char digitPairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Writes the digits of value right-aligned ending at end; returns the first
+static char* digits(char* end, uint32_t value)
+{
+    uint32_t pair;
+
+    while (value >= 100)
+    {
+        pair = value % 100;
+        value /= 100;
+        end -= 2;
+        end[0] = digitPairs[2 * pair];
+        end[1] = digitPairs[2 * pair + 1];
+    }
+    if (value >= 10)
+    {
+        end -= 2;
+        end[0] = digitPairs[2 * value];
+        end[1] = digitPairs[2 * value + 1];
+    }
+    else
+        *--end = '0' + value;
+    return end;
+}
+
+char* fmtUnsigned(char* p, uint32_t value)
+{
+    char buffer[FMT_UNSIGNED_MAX];
+    char* d = digits(buffer + FMT_UNSIGNED_MAX, value);
+
+    while (d < buffer + FMT_UNSIGNED_MAX)
+        *p++ = *d++;
+    *p = '\0';
+    return p;
+}
+
+// value right-aligned in at least width characters
+char* fmtPadded(char* p, uint32_t value, uint8_t width, char pad)
+{
+    char buffer[FMT_UNSIGNED_MAX];
+    char* d = digits(buffer + FMT_UNSIGNED_MAX, value);
+    uint8_t length = buffer + FMT_UNSIGNED_MAX - d;
+
+    while (width-- > length)
+        *p++ = pad;
+    while (d < buffer + FMT_UNSIGNED_MAX)
+        *p++ = *d++;
+    *p = '\0';
+    return p;
+}
+
+char* fmtString(char* p, const char* str)
+{
+    while (*str != '\0')
+        *p++ = *str++;
+    *p = '\0';
+    return p;
+}
+
+// "(red, green, blue)"
+char* fmtTriplet(char* p, uint16_t red, uint16_t green, uint16_t blue)
+{
+    *p++ = '(';
+    p = fmtUnsigned(p, red);
+    *p++ = ',';
+    *p++ = ' ';
+    p = fmtUnsigned(p, green);
+    *p++ = ',';
+    *p++ = ' ';
+    p = fmtUnsigned(p, blue);
+    *p++ = ')';
+    *p = '\0';
+    return p;
+}
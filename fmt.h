@@ -0,0 +1,28 @@
+// Format functions
+// Integer and RGB triplet formatting without printf
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef FMT_H_
+#define FMT_H_
+
+#include <stdint.h>
+
+#define FMT_UNSIGNED_MAX 10         // digits in a uint32_t
+#define FMT_TRIPLET_MAX  22         // "(65535, 65535, 65535)" and the terminator
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+char* fmtUnsigned(char* p, uint32_t value);
+char* fmtPadded(char* p, uint32_t value, uint8_t width, char pad);
+char* fmtString(char* p, const char* str);
+char* fmtTriplet(char* p, uint16_t red, uint16_t green, uint16_t blue);
+
+#endif
@@ -0,0 +1,261 @@
+// Frame functions
+// COBS-framed binary triplet output
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Binary output carries 1-30 triplets per frame (1-8 for periodic output), raw 16-bit samples instead of
+// the 8-bit values in the text output. Payload, little endian:
+//
+//   0    type (FRAME_TRIPLETS)
+//   1    sequence, uint16, one per frame
+//   3    count of triplets
+//   4    timestamp of the first triplet, uint32 us since resetFrames()
+//   8    count x { offset from the timestamp in FRAME_TICK_US, uint16;
+//                  red, green, blue, uint16 each }
+//   end  CRC-32 of everything before it
+//
+// The payload is COBS encoded, so it contains no zero bytes, and followed by
+// a zero byte. If anything else was written to the UART since the last frame
+// (a text line), a zero goes first as well, so the text cannot run into the
+// frame. A receiver that starts mid-stream resynchronizes at the next zero. A
+// batch is sent when it is full or when the next triplet's offset would not
+// fit; flushFrame() sends a partial one. encodeFrame() builds a frame from a
+// caller's buffer instead, for senders that do not go through putcUart0 (the
+// DMA stream). Both share the sequence number and the us clock.
+// tools/decodeframes.c is the reference decoder.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hal.h"
+#include "uart0.h"
+#include "crc.h"
+#include "frame.h"
+
+#define CLOCKS_PER_US   (SYSTEM_CLOCK / 1000000)
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static uint8_t payload[FRAME_PAYLOAD_MAX];
+static uint8_t batch = 1;
+static uint8_t count = 0;
+static uint16_t sequence = 0;
+static uint32_t frameTime;                  // us of the first triplet in payload
+
+static bool timeValid = false;
+static uint32_t lastCycles;                 // extends the cycle counter to a us clock
+static uint32_t micros;
+static uint32_t microsRemainder;
+
+static uint32_t txMark;                     // UART byte count after the last frame
+static bool txMarkValid = false;
+
+static uint32_t framesSent = 0;
+static uint32_t bytesSent = 0;
+static uint32_t tripletsSent = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static void put16(uint8_t* p, uint16_t value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t value)
+{
+    put16(p, value);
+    put16(p + 2, value >> 16);
+}
+
+// Consistent overhead byte stuffing; returns the encoded length, without the
+// zero delimiter
+uint16_t cobsEncode(const uint8_t* in, uint16_t length, uint8_t* out)
+{
+    uint16_t read = 0, write = 1, code = 0;
+    uint8_t run = 1;
+
+    while (read < length)
+    {
+        if (in[read] == 0)
+        {
+            out[code] = run;
+            code = write++;
+            run = 1;
+        }
+        else
+        {
+            out[write++] = in[read];
+            if (++run == 0xFF)
+            {
+                out[code] = run;
+                code = write++;
+                run = 1;
+            }
+        }
+        read++;
+    }
+    out[code] = run;
+    return write;
+}
+
+void setFrameBatch(uint8_t triplets)
+{
+    flushFrame();
+    if (triplets < 1)
+        triplets = 1;
+    if (triplets > FRAME_BATCH_MAX)
+        triplets = FRAME_BATCH_MAX;
+    batch = triplets;
+}
+
+uint8_t getFrameBatch()
+{
+    return batch;
+}
+
+// Drops a partial batch and restarts the sequence and the us clock
+void resetFrames()
+{
+    count = 0;
+    sequence = 0;
+    timeValid = false;
+    micros = 0;
+    microsRemainder = 0;
+    framesSent = bytesSent = tripletsSent = 0;
+}
+
+// us since resetFrames(); triplets must come less than 107 s apart
+static uint32_t toMicros(uint32_t cycles)
+{
+    uint32_t clocks;
+
+    if (!timeValid)
+    {
+        timeValid = true;
+        lastCycles = cycles;
+    }
+    clocks = cycles - lastCycles + microsRemainder;
+    lastCycles = cycles;
+    micros += clocks / CLOCKS_PER_US;
+    microsRemainder = clocks % CLOCKS_PER_US;
+    return micros;
+}
+
+// Fills in the header and the CRC of a payload holding count triplets and COBS
+// encodes it into out; returns the encoded length, without the zero delimiter
+static uint16_t sealFrame(uint8_t* frame, uint8_t count, uint32_t time, uint8_t* out)
+{
+    uint16_t length = FRAME_HEADER + count * FRAME_TRIPLET;
+
+    frame[0] = FRAME_TRIPLETS;
+    put16(frame + 1, sequence++);
+    frame[3] = count;
+    put32(frame + 4, time);
+    put32(frame + length, crc32(0, frame, length));
+    return cobsEncode(frame, length + FRAME_CRC, out);
+}
+
+// Sends the current batch, if any
+void flushFrame()
+{
+    uint8_t encoded[FRAME_ENCODED_MAX];
+    uint16_t length, i;
+
+    if (count == 0)
+        return;
+    length = sealFrame(payload, count, frameTime, encoded);
+    if (!txMarkValid || getTxWritten() != txMark)
+    {
+        putcUart0(0);
+        bytesSent++;
+    }
+    for (i = 0; i < length; i++)
+        putcUart0(encoded[i]);
+    putcUart0(0);
+    txMark = getTxWritten();
+    txMarkValid = true;
+    framesSent++;
+    bytesSent += length + 1;
+    tripletsSent += count;
+    count = 0;
+}
+
+// Encodes count (1 - FRAME_COUNT_MAX) triplets completed at the given cycle
+// counter values into out, FRAME_ENCODED_MAX bytes, zero delimiter included.
+// Returns the length, or 0 if the offsets do not fit one frame.
+uint16_t encodeFrame(const uint16_t (*rgb)[3], const uint32_t* cycles, uint8_t count, uint8_t* out)
+{
+    uint8_t frame[FRAME_PAYLOAD_MAX];
+    uint32_t time, us, offset;
+    uint16_t length;
+    uint8_t i, *p;
+
+    if (count < 1 || count > FRAME_COUNT_MAX)
+        return 0;
+    time = toMicros(cycles[0]);
+    for (i = 0; i < count; i++)
+    {
+        us = i == 0 ? time : toMicros(cycles[i]);
+        offset = (us - time) / FRAME_TICK_US;
+        if (offset > 0xFFFF)
+            return 0;
+        p = frame + FRAME_HEADER + i * FRAME_TRIPLET;
+        put16(p, offset);
+        put16(p + 2, rgb[i][0]);
+        put16(p + 4, rgb[i][1]);
+        put16(p + 6, rgb[i][2]);
+    }
+    length = sealFrame(frame, count, time, out);
+    out[length++] = 0;
+    return length;
+}
+
+// Adds a triplet completed at cycle counter value cycles, sending the batch
+// when it fills
+void addFrameTriplet(uint16_t red, uint16_t green, uint16_t blue, uint32_t cycles)
+{
+    uint32_t us = toMicros(cycles);
+    uint32_t offset;
+    uint8_t* p;
+
+    if (count != 0 && (us - frameTime) / FRAME_TICK_US > 0xFFFF)
+        flushFrame();
+    if (count == 0)
+        frameTime = us;
+    offset = (us - frameTime) / FRAME_TICK_US;
+    p = payload + FRAME_HEADER + count * FRAME_TRIPLET;
+    put16(p, offset);
+    put16(p + 2, red);
+    put16(p + 4, green);
+    put16(p + 6, blue);
+    if (++count == batch)
+        flushFrame();
+}
+
+uint32_t getFramesSent()
+{
+    return framesSent;
+}
+
+uint32_t getFrameBytesSent()
+{
+    return bytesSent;
+}
+
+uint32_t getFrameTripletsSent()
+{
+    return tripletsSent;
+}
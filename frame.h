@@ -0,0 +1,42 @@
+// Frame functions
+// COBS-framed binary triplet output
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef FRAME_H_
+#define FRAME_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FRAME_TRIPLETS      0x01        // frame type
+#define FRAME_BATCH_MAX     8           // triplets per frame, periodic output
+#define FRAME_COUNT_MAX     30          // triplets per frame, any sender; keeps one COBS block
+#define FRAME_HEADER        8           // type, sequence, count, timestamp
+#define FRAME_TRIPLET       8           // offset, red, green, blue
+#define FRAME_CRC           4
+#define FRAME_PAYLOAD_MAX   (FRAME_HEADER + FRAME_COUNT_MAX * FRAME_TRIPLET + FRAME_CRC)
+#define FRAME_ENCODED_MAX   (FRAME_PAYLOAD_MAX + FRAME_PAYLOAD_MAX / 254 + 2)
+#define FRAME_TICK_US       100         // units of the per-triplet time offset
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint16_t cobsEncode(const uint8_t* in, uint16_t length, uint8_t* out);
+void setFrameBatch(uint8_t triplets);
+uint8_t getFrameBatch();
+void resetFrames();
+void addFrameTriplet(uint16_t red, uint16_t green, uint16_t blue, uint32_t cycles);
+void flushFrame();
+uint16_t encodeFrame(const uint16_t (*rgb)[3], const uint32_t* cycles, uint8_t count, uint8_t* out);
+uint32_t getFramesSent();
+uint32_t getFrameBytesSent();
+uint32_t getFrameTripletsSent();
+
+#endif
@@ -0,0 +1,101 @@
+// Hardware abstraction layer
+// Everything in the firmware that touches a peripheral goes through here.
+// hal_tm4c.c implements it with TM4C123 registers, sim/sim.c implements it
+// with a simulated optical front end for the host build.
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef HAL_H_
+#define HAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SYSTEM_CLOCK 40000000       // system clock in Hz
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initHw();
+
+// Interrupt masking, returns/restores the previous mask state
+uint32_t disableInterrupts();
+void restoreInterrupts(uint32_t state);
+bool inInterrupt();
+void waitForInterrupt();
+// waitForInterrupt() at the points where the firmware waits for the operator,
+// called with interrupts masked; the simulator types its next line there
+void waitForInput();
+
+// Free-running 32-bit count of system clocks (wraps every 107 s)
+uint32_t readCycleCounter();
+
+// CPU time for benchmarks, in system clocks. The same counter as above on the
+// target; on the host it follows host time, since the simulated clock only
+// moves for modeled hardware.
+uint32_t readCpuCycles();
+
+// RGB backlight (PWM0 generators 1 and 2)
+void setRgbColor(uint16_t red, uint16_t green, uint16_t blue);
+
+// Light sensor (AIN0 on ADC0 SS3), polled or with the SS3 completion interrupt
+uint16_t readAdc0Ss3();
+void startAdc0Ss3();
+uint16_t readAdc0Ss3Result();
+
+// Burst of 1-8 conversions of AIN0 on ADC0 SS0, one interrupt for all of them
+void startAdc0Ss0(uint8_t count);
+uint8_t readAdc0Ss0Results(uint16_t* results);
+
+// AIN0 on ADC0 SS2, triggered by Timer3A every us microseconds
+void startSweepTimer(uint32_t us);
+void stopSweepTimer();
+uint16_t readAdc0Ss2Result();
+
+// Hardware averaging of 2^n samples per conversion, n = 0-6
+void setAdcAveraging(uint8_t log2n);
+
+// Timer2A one-shot interrupt for LED settling
+void startSettleTimer(uint32_t us);
+void stopSettleTimer();
+void clearSettleTimerInt();
+
+// Periodic interrupt that only wakes the CPU, so a WFI loop can check a timeout
+void startWakeTimer(uint32_t us);
+void stopWakeTimer();
+
+// UART0
+bool setUart0Baud(uint32_t baud);
+uint32_t getUart0Baud();
+bool isUart0Busy();
+void setUart0Loopback(bool on);
+uint32_t getUart0RxErrors();
+bool isUart0TxFull();
+void writeUart0Tx(char c);
+void enableUart0TxInt();
+void disableUart0TxInt();
+void clearUart0Int();
+bool isUart0RxEmpty();
+char readUart0Rx();
+
+// uDMA channel 9 feeds UART0 TX from memory; the UART0 interrupt fires when the
+// last byte has gone into the FIFO
+void startUart0TxDma(const uint8_t* data, uint16_t length);
+bool isUart0TxDmaBusy();
+
+// On-board green LED and SW1
+void setGreenLed(bool on);
+bool isPb1Pressed();
+
+// Timer1A periodic interrupt, load value in system clocks
+void enablePeriodTimer(uint32_t load);
+void disablePeriodTimer();
+void clearPeriodTimerInt();
+
+#endif
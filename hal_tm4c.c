@@ -0,0 +1,531 @@
+// Hardware abstraction layer (TM4C123 implementation)
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL Evaluation Board
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// Red LED:
+//   M0PWM3 (PB5) drives an PNP transistor that powers the red LED
+// Green LED:
+//   M0PWM5 (PE5) drives an PNP transistor that powers the green LED
+// Blue LED:
+//   M0PWM4 (PE4) drives an PNP transistor that powers the blue LED
+// Green LED (on-board):
+//   (PF3) Digitally enabled for flashing on every specified period
+// PUSH_BUTTON:
+//   SW1 (PF4) internal pull-up push button used for "button" cmd
+// Light Sensor:
+//   (PE3) [AINO] uses sample sequencer 3 (SS3) and takes one sample at a time
+// UART Interface:
+//   U0TX (PA1) and U0RX (PA0) are connected to the 2nd controller
+//   Configured to 115,200 baud, 8N1 at reset; setUart0Baud() changes the rate
+//   uDMA channel 9 (UART0 TX, encoding 0) can feed the TX FIFO from memory
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tm4c123gh6pm.h"
+#include "hal.h"
+
+#define PUSH_BUTTON1    (*((volatile uint32_t*)(0x42000000 + (0x400253FC - 0x40000000)*32 + 4*4)))
+#define GREEN_LED       (*((volatile uint32_t*)(0x42000000 + (0x400253FC - 0x40000000)*32 + 3*4)))
+
+// Core debug registers, not in tm4c123gh6pm.h
+#define DEMCR_R         (*((volatile uint32_t*)0xE000EDFC))
+#define DEMCR_TRCENA    0x01000000
+#define DWT_CTRL_R      (*((volatile uint32_t*)0xE0001000))
+#define DWT_CTRL_CYCCNTENA 0x00000001
+#define DWT_CYCCNT_R    (*((volatile uint32_t*)0xE0001004))
+
+#define UART_DR_ERRORS  0x00000F00      // OE, BE, PE, FE flags read with each character
+#define DMA_UART0_TX    9               // uDMA channel, encoding 0
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static uint32_t uart0RxErrors = 0;          // characters received with an error flag
+
+// uDMA control table, primary structures only: source end, destination end,
+// control word, unused
+#pragma DATA_ALIGN(dmaTable, 1024)
+static volatile uint32_t dmaTable[32 * 4];
+
+//-----------------------------------------------------------------------------
+// Initialize Hardware
+//-----------------------------------------------------------------------------
+
+void initHw()
+{
+    // Configure HW to work with 16 MHz XTAL, PLL enabled, system clock of 40 MHz
+    // PWM is system clock / 2
+    SYSCTL_RCC_R = SYSCTL_RCC_XTAL_16MHZ | SYSCTL_RCC_OSCSRC_MAIN | SYSCTL_RCC_USESYSDIV | (4 << SYSCTL_RCC_SYSDIV_S)
+                | SYSCTL_RCC_USEPWMDIV | SYSCTL_RCC_PWMDIV_2;
+    // Set GPIO ports to use APB (not needed since default configuration -- for clarity)
+    // Note UART on port A must use APB
+    SYSCTL_GPIOHBCTL_R = 0;
+
+    // Enable clock gating
+    SYSCTL_RCGC2_R = SYSCTL_RCGC2_GPIOA | SYSCTL_RCGC2_GPIOB | SYSCTL_RCGC2_GPIOE;  // GPIO port A, B, E peripherals
+    SYSCTL_RCGC2_R |= SYSCTL_RCGC2_GPIOF;           // enable port f
+    SYSCTL_RCGCUART_R |= SYSCTL_RCGCUART_R0;         // turn-on UART0, leave other uarts in same status
+    SYSCTL_RCGCSSI_R |= SYSCTL_RCGCSSI_R2;          // turn-on SSI2 clocking
+    SYSCTL_RCGC0_R |= SYSCTL_RCGC0_PWM0;            // turn-on PWM0 module
+    SYSCTL_RCGCADC_R |= 1;                          // turn on ADC module 0 clocking
+    SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R1;      // turn on timer 1
+    SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R2;      // turn on timer 2
+    SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R3;      // turn on timer 3
+    SYSCTL_RCGCEEPROM_R = 0x01;                     // turn on EEPROM clocking
+    SYSCTL_RCGCDMA_R |= SYSCTL_RCGCDMA_R0;          // turn on uDMA clocking
+
+    // Start the DWT cycle counter
+    DEMCR_R |= DEMCR_TRCENA;                        // enable trace and debug blocks
+    DWT_CYCCNT_R = 0;
+    DWT_CTRL_R |= DWT_CTRL_CYCCNTENA;               // count every system clock
+
+    // Configure switch 1, aka push button 1 on port f4
+    GPIO_PORTF_DEN_R |= 0x10;                       // enable bit 16 (1 left-shifted 4)
+    GPIO_PORTF_PUR_R |= 0x10;                       // enable internal pull-up for PB1
+
+    // Configure green LED on board [PF3]
+    GPIO_PORTF_DIR_R |= 1 << 3;     // set bit 3 to output
+    GPIO_PORTF_DR2R_R |= 1 << 3;    // set drive strenth to 2mA (default)
+    GPIO_PORTF_DEN_R |= 1 << 3;     // enable green LED
+
+    // Configure three backlight LEDs
+    GPIO_PORTB_DIR_R |= 0x20;   // make bit5 an output
+    GPIO_PORTB_DR2R_R |= 0x20;  // set drive strength to 2mA
+    GPIO_PORTB_DEN_R |= 0x20;   // enable bit5 for digital
+    GPIO_PORTB_ODR_R |= 0x20;
+    GPIO_PORTB_AFSEL_R |= 0x20; // select auxilary function for bit 5
+    GPIO_PORTB_PCTL_R = GPIO_PCTL_PB5_M0PWM3; // enable PWM on bit 5
+    GPIO_PORTE_DIR_R |= 0x30;   // make bits 4 and 5 outputs
+    GPIO_PORTE_DR2R_R |= 0x30;  // set drive strength to 2mA
+    GPIO_PORTE_DEN_R |= 0x30;   // enable bits 4 and 5 for digital
+    GPIO_PORTE_ODR_R |= 0x30;
+    GPIO_PORTE_AFSEL_R |= 0x30; // select auxilary function for bits 4 and 5
+    GPIO_PORTE_PCTL_R = GPIO_PCTL_PE4_M0PWM4 | GPIO_PCTL_PE5_M0PWM5; // enable PWM on bits 4 and 5
+
+    // Configure AIN0 as an analog input
+    GPIO_PORTE_AFSEL_R |= 0X08;                     // select alternative functions for AIN0 (PE3)
+    GPIO_PORTE_DEN_R &= ~0X08;                      // turn off digital operation on pin PE3
+    GPIO_PORTE_AMSEL_R |= 0X08;                     // turn on analog operation on pin PE3
+
+    // Configure ADC
+    ADC0_CC_R = ADC_CC_CS_SYSPLL;                  // select PLL as base time (not needed, already default)
+    ADC0_ACTSS_R &= ~ADC_ACTSS_ASEN3;              // disable sample sequencer 3 (SS3) for programming
+    ADC0_EMUX_R = ADC_EMUX_EM3_PROCESSOR;          // select SS3 bit in ADCPSSI as trigger
+    ADC0_SSMUX3_R = 0;                              // set first sample to AIN0
+    ADC0_SSCTL3_R = ADC_SSCTL3_END0;                // mark first sample as the end
+    ADC0_ACTSS_R |= ADC_ACTSS_ASEN3;                 // enable SS3 for operation
+    NVIC_EN0_R |= 1 << (INT_ADC0SS3-16);             // turn-on interrupt 33 (ADC0SS3), IM set per conversion
+    ADC0_ACTSS_R &= ~ADC_ACTSS_ASEN0;              // disable sample sequencer 0 (SS0) for programming
+    ADC0_EMUX_R |= ADC_EMUX_EM0_PROCESSOR;         // select SS0 bit in ADCPSSI as trigger
+    ADC0_SSMUX0_R = 0;                              // all 8 steps sample AIN0
+    ADC0_IM_R |= ADC_IM_MASK0;                      // interrupt on SS0 completion
+    NVIC_EN0_R |= 1 << (INT_ADC0SS0-16);             // turn-on interrupt 30 (ADC0SS0)
+    ADC0_ACTSS_R &= ~ADC_ACTSS_ASEN2;              // disable sample sequencer 2 (SS2) for programming
+    ADC0_EMUX_R |= ADC_EMUX_EM2_TIMER;             // SS2 is triggered by a timer (Timer3A, TAOTE)
+    ADC0_SSMUX2_R = 0;                              // set first sample to AIN0
+    ADC0_SSCTL2_R = ADC_SSCTL2_END0 | ADC_SSCTL2_IE0; // one sample, interrupt when done
+    ADC0_IM_R |= ADC_IM_MASK2;                      // interrupt on SS2 completion
+    ADC0_ACTSS_R |= ADC_ACTSS_ASEN2;                 // enable SS2 for operation
+    NVIC_EN0_R |= 1 << (INT_ADC0SS2-16);             // turn-on interrupt 32 (ADC0SS2)
+    ADC0_SAC_R = ADC_SAC_AVG_OFF;                   // no hardware averaging
+
+    // Configure UART0 pins
+    GPIO_PORTA_DIR_R |= 2;                           // enable output on UART0 TX pin: default, added for clarity
+    GPIO_PORTA_DEN_R |= 3;                           // enable digital on UART0 pins: default, added for clarity
+    GPIO_PORTA_AFSEL_R |= 3;                         // use peripheral to drive PA0, PA1: default, added for clarity
+    GPIO_PORTA_PCTL_R &= 0xFFFFFF00;                 // set fields for PA0 and PA1 to zero
+    GPIO_PORTA_PCTL_R = GPIO_PCTL_PA1_U0TX | GPIO_PCTL_PA0_U0RX;
+                                                     // select UART0 to drive pins PA0 and PA1: default, added for clarity
+
+    // Configure UART0 to 115200 baud, 8N1 format (must be 3 clocks from clock enable and config writes)
+    UART0_CTL_R = 0;                                 // turn-off UART0 to allow safe programming
+    UART0_CC_R = UART_CC_CS_SYSCLK;                  // use system clock (40 MHz)
+    UART0_IBRD_R = 21;                               // r = 40 MHz / (Nx115.2kHz), set floor(r)=21, where N=16
+    UART0_FBRD_R = 45;                               // round(fract(r)*64)=45
+    UART0_LCRH_R = UART_LCRH_WLEN_8 | UART_LCRH_FEN; // configure for 8N1 w/ 16-level FIFO
+    UART0_CTL_R = UART_CTL_TXE | UART_CTL_RXE | UART_CTL_UARTEN; // enable TX, RX, and module
+    UART0_IFLS_R = UART_IFLS_TX4_8 | UART_IFLS_RX1_8;// TX interrupt at half full, RX at 2 characters
+    UART0_IM_R = UART_IM_RXIM | UART_IM_RTIM;        // RX and receive timeout interrupts, TXIM only when needed
+    NVIC_EN0_R |= 1 << (INT_UART0-16);               // turn-on interrupt 21 (UART0)
+
+    // Configure uDMA channel 9 for UART0 TX, basic mode, started by startUart0TxDma()
+    UDMA_CFG_R = UDMA_CFG_MASTEN;                    // enable the controller
+    UDMA_CTLBASE_R = (uint32_t)dmaTable;
+    UDMA_CHMAP1_R &= ~UDMA_CHMAP1_CH9SEL_M;          // encoding 0: UART0 TX
+    UDMA_PRIOCLR_R = 1 << DMA_UART0_TX;              // default priority
+    UDMA_ALTCLR_R = 1 << DMA_UART0_TX;               // primary control structure
+    UDMA_USEBURSTCLR_R = 1 << DMA_UART0_TX;          // single and burst requests
+    UDMA_REQMASKCLR_R = 1 << DMA_UART0_TX;           // let the UART request transfers
+
+    // Configure PWM module0 to drive RGB backlight
+    // RED   on M0PWM3 (PB5), M0PWM1b
+    // BLUE  on M0PWM4 (PE4), M0PWM2a
+    // GREEN on M0PWM5 (PE5), M0PWM2b
+    __asm(" NOP");                                   // wait 3 clocks
+    __asm(" NOP");
+    __asm(" NOP");
+    SYSCTL_SRPWM_R = SYSCTL_SRPWM_R0;                // reset PWM0 module
+    SYSCTL_SRPWM_R = 0;                              // leave reset state
+    PWM0_1_CTL_R = 0;                                // turn-off PWM0 generator 1
+    PWM0_2_CTL_R = 0;                                // turn-off PWM0 generator 2
+    PWM0_1_GENB_R = PWM_0_GENB_ACTCMPBD_ZERO | PWM_0_GENB_ACTLOAD_ONE;
+                                                     // output 3 on PWM0, gen 1b, cmpb
+    PWM0_2_GENA_R = PWM_0_GENA_ACTCMPAD_ZERO | PWM_0_GENA_ACTLOAD_ONE;
+                                                     // output 4 on PWM0, gen 2a, cmpa
+    PWM0_2_GENB_R = PWM_0_GENB_ACTCMPBD_ZERO | PWM_0_GENB_ACTLOAD_ONE;
+                                                     // output 5 on PWM0, gen 2b, cmpb
+    PWM0_1_LOAD_R = 1024;                            // set period to 40 MHz sys clock / 2 / 1024 = 19.53125 kHz
+    PWM0_2_LOAD_R = 1024;
+    //PWM0_INVERT_R = PWM_INVERT_PWM3INV | PWM_INVERT_PWM4INV | PWM_INVERT_PWM5INV;
+                                                     // invert outputs for duty cycle increases with increasing compare values
+    PWM0_1_CMPB_R = 0;                               // red off (0=always low, 1023=always high)
+    PWM0_2_CMPB_R = 0;                               // green off
+    PWM0_2_CMPA_R = 0;                               // blue off
+
+    PWM0_1_CTL_R = PWM_0_CTL_ENABLE;                 // turn-on PWM0 generator 1
+    PWM0_2_CTL_R = PWM_0_CTL_ENABLE;                 // turn-on PWM0 generator 2
+    PWM0_ENABLE_R = PWM_ENABLE_PWM3EN | PWM_ENABLE_PWM4EN | PWM_ENABLE_PWM5EN;
+                                                     // enable outputs
+
+    // Configure Timer 1 for periodic interrupt service [periodIsr()]
+    TIMER1_CTL_R &= ~TIMER_CTL_TAEN;                 // turn-off timer before reconfiguring
+    TIMER1_CFG_R = TIMER_CFG_32_BIT_TIMER;           // configure as 32-bit timer (A+B)
+    TIMER1_TAMR_R = TIMER_TAMR_TAMR_PERIOD;          // configure for periodic mode (count down)
+    TIMER1_TAILR_R = 0x30D40;                        // set load value to 2e5 for 200 Hz interrupt rate
+    TIMER1_IMR_R = TIMER_IMR_TATOIM;                 // turn-on interrupts
+    //NVIC_EN0_R |= 1 << (INT_TIMER1A-16);           // turn-on interrupt 37 (TIMER1A)
+    //TIMER1_CTL_R |= TIMER_CTL_TAEN;                // turn-on timer
+
+    // Configure Timer 2 as a one-shot for LED settling [settleTimerIsr()]
+    TIMER2_CTL_R &= ~TIMER_CTL_TAEN;                 // turn-off timer before reconfiguring
+    TIMER2_CFG_R = TIMER_CFG_32_BIT_TIMER;           // configure as 32-bit timer (A+B)
+    TIMER2_TAMR_R = TIMER_TAMR_TAMR_1_SHOT;          // configure for one-shot mode (count down)
+    TIMER2_IMR_R = TIMER_IMR_TATOIM;                 // turn-on interrupts
+    NVIC_EN0_R |= 1 << (INT_TIMER2A-16);             // turn-on interrupt 39 (TIMER2A)
+
+    // Configure Timer 3 to trigger ADC0 SS2 for sweeps, no timer interrupt
+    TIMER3_CTL_R &= ~TIMER_CTL_TAEN;                 // turn-off timer before reconfiguring
+    TIMER3_CFG_R = TIMER_CFG_32_BIT_TIMER;           // configure as 32-bit timer (A+B)
+    TIMER3_TAMR_R = TIMER_TAMR_TAMR_PERIOD;          // configure for periodic mode (count down)
+    TIMER3_CTL_R |= TIMER_CTL_TAOTE;                 // timeout triggers the ADC
+}
+
+//-----------------------------------------------------------------------------
+// Interrupt masking
+//-----------------------------------------------------------------------------
+
+uint32_t disableInterrupts()
+{
+    return _disable_interrupts();                   // returns previous PRIMASK
+}
+
+void restoreInterrupts(uint32_t state)
+{
+    _restore_interrupts(state);
+}
+
+bool inInterrupt()
+{
+    return (NVIC_INT_CTRL_R & NVIC_INT_CTRL_VEC_ACT_M) != 0;
+}
+
+void waitForInterrupt()
+{
+    __asm(" WFI");
+}
+
+void waitForInput()
+{
+    __asm(" WFI");
+}
+
+uint32_t readCycleCounter()
+{
+    return DWT_CYCCNT_R;
+}
+
+uint32_t readCpuCycles()
+{
+    return DWT_CYCCNT_R;
+}
+
+//-----------------------------------------------------------------------------
+// RGB backlight and light sensor
+//-----------------------------------------------------------------------------
+
+void setRgbColor(uint16_t red, uint16_t green, uint16_t blue)
+{
+    PWM0_1_CMPB_R = red;
+    PWM0_2_CMPA_R = blue;
+    PWM0_2_CMPB_R = green;
+}
+
+uint16_t readAdc0Ss3()
+{
+    ADC0_PSSI_R |= ADC_PSSI_SS3;                    // set start bit
+    while(ADC0_ACTSS_R & ADC_ACTSS_BUSY);           // wait until SS3 is not busy
+    return ADC0_SSFIFO3_R;                          // get single result from the FIFO
+}
+
+// Starts a conversion that interrupts when done [adc0Ss3Isr()]
+void startAdc0Ss3()
+{
+    ADC0_ISC_R = ADC_ISC_IN3;                       // clear a completion left by readAdc0Ss3
+    ADC0_IM_R |= ADC_IM_MASK3;                      // interrupt on SS3 completion
+    ADC0_PSSI_R |= ADC_PSSI_SS3;                    // set start bit
+}
+
+uint16_t readAdc0Ss3Result()
+{
+    ADC0_IM_R &= ~ADC_IM_MASK3;                     // polled reads must not interrupt
+    ADC0_ISC_R = ADC_ISC_IN3;                       // clear interrupt
+    return ADC0_SSFIFO3_R;
+}
+
+// Starts a burst of count (1-8) conversions that interrupts when all are done
+// [adc0Ss0Isr()]
+void startAdc0Ss0(uint8_t count)
+{
+    ADC0_ACTSS_R &= ~ADC_ACTSS_ASEN0;               // disable SS0 for programming
+    ADC0_SSCTL0_R = (ADC_SSCTL0_END0 | ADC_SSCTL0_IE0) << (4 * (count - 1));
+                                                    // end and interrupt at the last step
+    ADC0_ACTSS_R |= ADC_ACTSS_ASEN0;                // enable SS0 for operation
+    ADC0_PSSI_R |= ADC_PSSI_SS0;                    // set start bit
+}
+
+uint8_t readAdc0Ss0Results(uint16_t* results)
+{
+    uint8_t count = 0;
+    ADC0_ISC_R = ADC_ISC_IN0;                       // clear interrupt
+    while (!(ADC0_SSFSTAT0_R & ADC_SSFSTAT0_EMPTY) && count < 8)
+        results[count++] = ADC0_SSFIFO0_R;
+    return count;
+}
+
+void startSweepTimer(uint32_t us)
+{
+    TIMER3_CTL_R &= ~TIMER_CTL_TAEN;                // turn-off timer
+    ADC0_ISC_R = ADC_ISC_IN2;                       // clear a stale completion
+    TIMER3_TAILR_R = us * (SYSTEM_CLOCK / 1000000) - 1; // period in system clocks
+    TIMER3_CTL_R |= TIMER_CTL_TAEN;                 // turn-on timer
+}
+
+void stopSweepTimer()
+{
+    TIMER3_CTL_R &= ~TIMER_CTL_TAEN;                // turn-off timer
+}
+
+uint16_t readAdc0Ss2Result()
+{
+    ADC0_ISC_R = ADC_ISC_IN2;                       // clear interrupt
+    return ADC0_SSFIFO2_R;
+}
+
+void setAdcAveraging(uint8_t log2n)
+{
+    ADC0_SAC_R = log2n;                             // 0 = off ... 6 = 64x
+}
+
+//-----------------------------------------------------------------------------
+// Timer2 one-shot settle timer
+//-----------------------------------------------------------------------------
+
+void startSettleTimer(uint32_t us)
+{
+    TIMER2_CTL_R &= ~TIMER_CTL_TAEN;                // turn-off timer
+    TIMER2_TAILR_R = us * (SYSTEM_CLOCK / 1000000); // load value in system clocks
+    TIMER2_CTL_R |= TIMER_CTL_TAEN;                 // turn-on timer
+}
+
+void stopSettleTimer()
+{
+    TIMER2_CTL_R &= ~TIMER_CTL_TAEN;                // turn-off timer
+    TIMER2_ICR_R = TIMER_ICR_TATOCINT;              // drop a pending timeout
+}
+
+void clearSettleTimerInt()
+{
+    TIMER2_ICR_R = TIMER_ICR_TATOCINT;              // clear bit (processed interrupt)
+}
+
+//-----------------------------------------------------------------------------
+// Wake timer
+//-----------------------------------------------------------------------------
+
+// SysTick, us up to 419 ms
+void startWakeTimer(uint32_t us)
+{
+    NVIC_ST_CTRL_R = 0;
+    NVIC_ST_RELOAD_R = us * (SYSTEM_CLOCK / 1000000) - 1;
+    NVIC_ST_CURRENT_R = 0;
+    NVIC_ST_CTRL_R = NVIC_ST_CTRL_CLK_SRC | NVIC_ST_CTRL_INTEN | NVIC_ST_CTRL_ENABLE;
+}
+
+void stopWakeTimer()
+{
+    NVIC_ST_CTRL_R = 0;
+}
+
+// Nothing to do, waking up was the point
+void wakeTimerIsr()
+{
+}
+
+//-----------------------------------------------------------------------------
+// UART0
+//-----------------------------------------------------------------------------
+
+// Divisor in 1/64ths: r = clock / (16 x baud), IBRD = floor(r), FBRD = round(fract(r) x 64).
+// Call with the transmitter idle.
+bool setUart0Baud(uint32_t baud)
+{
+    uint32_t divisor;
+
+    if (baud == 0 || baud > SYSTEM_CLOCK / 16)
+        return false;
+    divisor = (SYSTEM_CLOCK * 4 + baud / 2) / baud;
+    if (divisor >> 6 == 0 || divisor >> 6 > 0xFFFF)
+        return false;
+    UART0_CTL_R &= ~UART_CTL_UARTEN;                 // turn-off UART0 to allow safe programming
+    UART0_IBRD_R = divisor >> 6;
+    UART0_FBRD_R = divisor & 63;
+    UART0_LCRH_R = UART_LCRH_WLEN_8 | UART_LCRH_FEN; // divisor changes take effect on an LCRH write
+    UART0_CTL_R |= UART_CTL_UARTEN;
+    return true;
+}
+
+// Rate the divisors actually give
+uint32_t getUart0Baud()
+{
+    uint32_t divisor = (UART0_IBRD_R << 6) | UART0_FBRD_R;
+    return (SYSTEM_CLOCK * 4 + divisor / 2) / divisor;
+}
+
+bool isUart0Busy()
+{
+    return (UART0_FR_R & UART_FR_BUSY) != 0;
+}
+
+// TX fed straight back into RX inside the UART
+void setUart0Loopback(bool on)
+{
+    if (on)
+        UART0_CTL_R |= UART_CTL_LBE;
+    else
+        UART0_CTL_R &= ~UART_CTL_LBE;
+}
+
+uint32_t getUart0RxErrors()
+{
+    return uart0RxErrors;
+}
+
+bool isUart0TxFull()
+{
+    return (UART0_FR_R & UART_FR_TXFF) != 0;
+}
+
+void writeUart0Tx(char c)
+{
+    UART0_DR_R = c;                                  // write character to fifo
+}
+
+void enableUart0TxInt()
+{
+    UART0_IM_R |= UART_IM_TXIM;
+}
+
+void disableUart0TxInt()
+{
+    UART0_IM_R &= ~UART_IM_TXIM;
+}
+
+void clearUart0Int()
+{
+    UART0_ICR_R = UART_ICR_TXIC | UART_ICR_RXIC | UART_ICR_RTIC;
+    if (UDMA_CHIS_R & (1 << DMA_UART0_TX))          // transfer done, signaled on the UART0 vector
+    {
+        UDMA_CHIS_R = 1 << DMA_UART0_TX;
+        UART0_DMACTL_R &= ~UART_DMACTL_TXDMAE;
+    }
+}
+
+// Sends 1-1024 bytes without the CPU; the UART0 interrupt fires once the last
+// one is in the FIFO. data must stay untouched until isUart0TxDmaBusy() is false.
+void startUart0TxDma(const uint8_t* data, uint16_t length)
+{
+    volatile uint32_t* entry = &dmaTable[DMA_UART0_TX * 4];
+
+    entry[0] = (uint32_t)(data + length - 1);        // source end pointer
+    entry[1] = (uint32_t)&UART0_DR_R;                // destination, does not increment
+    entry[2] = UDMA_CHCTL_DSTINC_NONE | UDMA_CHCTL_DSTSIZE_8 | UDMA_CHCTL_SRCINC_8 | UDMA_CHCTL_SRCSIZE_8
+             | UDMA_CHCTL_ARBSIZE_4 | ((uint32_t)(length - 1) << UDMA_CHCTL_XFERSIZE_S) | UDMA_CHCTL_XFERMODE_BASIC;
+    UART0_DMACTL_R |= UART_DMACTL_TXDMAE;
+    UDMA_ENASET_R = 1 << DMA_UART0_TX;
+}
+
+// The controller clears the enable bit when the transfer completes
+bool isUart0TxDmaBusy()
+{
+    return (UDMA_ENASET_R & (1 << DMA_UART0_TX)) != 0;
+}
+
+bool isUart0RxEmpty()
+{
+    return (UART0_FR_R & UART_FR_RXFE) != 0;
+}
+
+char readUart0Rx()
+{
+    uint32_t data = UART0_DR_R;                      // get character from fifo
+    if (data & UART_DR_ERRORS)
+        uart0RxErrors++;
+    return data & 0xFF;
+}
+
+//-----------------------------------------------------------------------------
+// On-board LED and push button
+//-----------------------------------------------------------------------------
+
+void setGreenLed(bool on)
+{
+    GREEN_LED = on;
+}
+
+bool isPb1Pressed()
+{
+    return !PUSH_BUTTON1;                           // pulled up, reads 0 when pressed
+}
+
+//-----------------------------------------------------------------------------
+// Timer1 periodic interrupt
+//-----------------------------------------------------------------------------
+
+void enablePeriodTimer(uint32_t load)
+{
+    TIMER1_TAILR_R = load;                          // set new calculated load value
+    NVIC_EN0_R |= 1 << (INT_TIMER1A-16);            // turn-on interrupt 37 (TIMER1A)
+    TIMER1_CTL_R |= TIMER_CTL_TAEN;                 // turn-on timer
+}
+
+void disablePeriodTimer()
+{
+    TIMER1_CTL_R &= ~TIMER_CTL_TAEN;                // turn-off timer
+}
+
+void clearPeriodTimerInt()
+{
+    TIMER1_ICR_R = TIMER_ICR_TATOCINT;              // clear bit (processed interrupt)
+}
@@ -0,0 +1,192 @@
+// Library functions
+// Reference color library in flash with a 3-D grid index
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// The RGB cube is split into 2^bits cells per axis, with bits chosen from the
+// library size so each cell holds a few entries. The table of packed colors
+// is sorted by cell
+// ahead of time (tools/mklibrary writes library_data.c), so the index is only
+// a cell start array and everything stays in flash.
+//
+// A match query for radius E visits the block of cells that overlaps the cube
+// of side 2E around the sample, skipping cells whose nearest point is already
+// further than E, and scans those cells only with the packed distance kernel
+// (scanPacked, DSP instructions where the core has them).
+// The cost depends on E and the entries per cell, not on the library size.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "distance.h"
+#include "library.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static uint32_t visited = 0;                // entries compared, for the bench
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Smallest grid that averages LIBRARY_PER_CELL entries or fewer per cell
+uint8_t libraryGridBits(uint16_t count)
+{
+    uint8_t bits = 1;
+
+    while (bits < LIBRARY_MAX_BITS && count > LIBRARY_PER_CELL * libraryCells(bits))
+        bits++;
+    return bits;
+}
+
+uint16_t libraryCells(uint8_t gridBits)
+{
+    return 1 << (3 * gridBits);
+}
+
+static uint16_t cellOf(const uint8_t* rgb, uint8_t gridBits)
+{
+    uint8_t shift = 8 - gridBits;
+
+    return ((rgb[0] >> shift) << (2 * gridBits)) | ((rgb[1] >> shift) << gridBits) | (rgb[2] >> shift);
+}
+
+// Counting sort of the entries by cell; sortedId gets each entry's input index
+void libraryBuild(const uint8_t (*rgb)[3], uint16_t count, uint8_t gridBits,
+                  uint32_t* sortedRgb, uint16_t* sortedId, uint16_t* cellStart)
+{
+    uint16_t cells = libraryCells(gridBits);
+    uint16_t i, c, next, total = 0;
+
+    for (c = 0; c <= cells; c++)
+        cellStart[c] = 0;
+    for (i = 0; i < count; i++)
+        cellStart[cellOf(rgb[i], gridBits)]++;
+    for (c = 0; c <= cells; c++)
+    {
+        next = total + cellStart[c];
+        cellStart[c] = total;
+        total = next;
+    }
+    // cellStart[c] is used as the insertion point, then shifted back
+    for (i = 0; i < count; i++)
+    {
+        c = cellOf(rgb[i], gridBits);
+        sortedRgb[cellStart[c]] = PACK_RGB(rgb[i][0], rgb[i][1], rgb[i][2]);
+        sortedId[cellStart[c]] = i;
+        cellStart[c]++;
+    }
+    for (c = cells; c > 0; c--)
+        cellStart[c] = cellStart[c - 1];
+    cellStart[0] = 0;
+}
+
+static uint32_t squared(int32_t d)
+{
+    return d * d;
+}
+
+// Squared distance from v to the nearest point of cell c along one axis
+static uint32_t axisGap(int32_t v, uint8_t c, uint8_t shift)
+{
+    int32_t low = c << shift;
+    int32_t high = low + (1 << shift) - 1;
+
+    if (v < low)
+        return squared(low - v);
+    if (v > high)
+        return squared(v - high);
+    return 0;
+}
+
+// Scans entries first to last-1, appending the ids of matches after found
+static uint16_t matchRange(const struct library* lib, uint16_t first, uint16_t last,
+                           uint32_t sample, uint32_t e2, uint16_t* ids, uint16_t maxIds, uint16_t found)
+{
+    uint16_t room = found < maxIds ? maxIds - found : 0;
+    uint16_t n, i;
+
+    visited += last - first;
+    n = scanPacked(lib->rgb + first, last - first, sample, e2, ids + found, room);
+    for (i = 0; i < n && i < room; i++)
+        ids[found + i] = lib->id[first + ids[found + i]];
+    return found + n;
+}
+
+// Finds the entries closer than sqrt(e2) to the sample. Stores up to maxIds
+// of their ids and returns how many there are in total.
+uint16_t libraryMatch(const struct library* lib, uint16_t red, uint16_t green, uint16_t blue,
+                      uint32_t e2, uint16_t* ids, uint16_t maxIds)
+{
+    uint8_t shift = 8 - lib->gridBits;
+    uint8_t top = (1 << lib->gridBits) - 1;
+    uint8_t low[3], high[3];
+    uint8_t r, g, b;
+    int32_t v[3];
+    uint32_t e, gapR, gapG, gapB;
+    uint32_t sample = PACK_RGB(red, green, blue);
+    uint16_t cell, found = 0;
+    uint8_t i;
+
+    if (e2 == 0)
+        return 0;
+    // radius rounded up, so the box of cells covers every point closer than E
+    e = isqrt32(e2);
+    if (e * e < e2)
+        e++;
+    v[0] = red;
+    v[1] = green;
+    v[2] = blue;
+    for (i = 0; i < 3; i++)
+    {
+        int32_t lo = v[i] - (int32_t)e;
+        int32_t hi = v[i] + (int32_t)e;
+        if (lo > 255 || hi < 0)
+            return 0;
+        low[i] = lo < 0 ? 0 : lo >> shift;
+        high[i] = hi > 255 ? top : hi >> shift;
+    }
+    for (r = low[0]; r <= high[0]; r++)
+    {
+        gapR = axisGap(v[0], r, shift);
+        for (g = low[1]; g <= high[1]; g++)
+        {
+            gapG = gapR + axisGap(v[1], g, shift);
+            if (gapG >= e2)
+                continue;
+            for (b = low[2]; b <= high[2]; b++)
+            {
+                gapB = gapG + axisGap(v[2], b, shift);
+                if (gapB >= e2)
+                    continue;
+                cell = (r << (2 * lib->gridBits)) | (g << lib->gridBits) | b;
+                found = matchRange(lib, lib->cellStart[cell], lib->cellStart[cell + 1],
+                                   sample, e2, ids, maxIds, found);
+            }
+        }
+    }
+    return found;
+}
+
+// Same as libraryMatch, comparing every entry
+uint16_t libraryMatchLinear(const struct library* lib, uint16_t red, uint16_t green, uint16_t blue,
+                            uint32_t e2, uint16_t* ids, uint16_t maxIds)
+{
+    return matchRange(lib, 0, lib->count, PACK_RGB(red, green, blue), e2, ids, maxIds, 0);
+}
+
+// Running total of entries compared by both searches
+uint32_t getLibraryVisited()
+{
+    return visited;
+}
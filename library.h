@@ -0,0 +1,49 @@
+// Library functions
+// Reference color library in flash with a 3-D grid index
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef LIBRARY_H_
+#define LIBRARY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LIBRARY_MAX_BITS    4       // up to 16 x 16 x 16 grid cells
+#define LIBRARY_PER_CELL    4       // average entries per cell the grid aims for
+#define LIBRARY_REPORT      8       // matches printed per sample
+
+// Entries are packed 0x00BBGGRR words (PACK_RGB) sorted by grid cell;
+// cellStart[c] is the first entry of cell c and cellStart[cells] the entry
+// count. id is the entry's line in the source.
+struct library
+{
+    const uint32_t* rgb;
+    const uint16_t* id;
+    const uint16_t* cellStart;
+    uint16_t count;
+    uint8_t gridBits;               // 2^bits cells per axis
+};
+
+extern const struct library referenceLibrary;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint8_t libraryGridBits(uint16_t count);
+uint16_t libraryCells(uint8_t gridBits);
+void libraryBuild(const uint8_t (*rgb)[3], uint16_t count, uint8_t gridBits,
+                  uint32_t* sortedRgb, uint16_t* sortedId, uint16_t* cellStart);
+uint16_t libraryMatch(const struct library* lib, uint16_t red, uint16_t green, uint16_t blue,
+                      uint32_t e2, uint16_t* ids, uint16_t maxIds);
+uint16_t libraryMatchLinear(const struct library* lib, uint16_t red, uint16_t green, uint16_t blue,
+                            uint32_t e2, uint16_t* ids, uint16_t maxIds);
+uint32_t getLibraryVisited();
+
+#endif
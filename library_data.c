@@ -0,0 +1,72 @@
+// Reference color library
+// Generated by tools/mklibrary from library.csv, do not edit
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "library.h"
+
+// 216 colors, 4 x 4 x 4 grid
+static const uint32_t libraryRgb[216] =
+{
+    0x000000, 0x330000, 0x003300, 0x333300, 0x000033, 0x330033, 0x003333, 0x333333,
+    0x660000, 0x663300, 0x660033, 0x663333, 0x990000, 0x993300, 0x990033, 0x993333,
+    0xCC0000, 0xFF0000, 0xCC3300, 0xFF3300, 0xCC0033, 0xFF0033, 0xCC3333, 0xFF3333,
+    0x006600, 0x336600, 0x006633, 0x336633, 0x666600, 0x666633, 0x996600, 0x996633,
+    0xCC6600, 0xFF6600, 0xCC6633, 0xFF6633, 0x009900, 0x339900, 0x009933, 0x339933,
+    0x669900, 0x669933, 0x999900, 0x999933, 0xCC9900, 0xFF9900, 0xCC9933, 0xFF9933,
+    0x00CC00, 0x33CC00, 0x00FF00, 0x33FF00, 0x00CC33, 0x33CC33, 0x00FF33, 0x33FF33,
+    0x66CC00, 0x66FF00, 0x66CC33, 0x66FF33, 0x99CC00, 0x99FF00, 0x99CC33, 0x99FF33,
+    0xCCCC00, 0xFFCC00, 0xCCFF00, 0xFFFF00, 0xCCCC33, 0xFFCC33, 0xCCFF33, 0xFFFF33,
+    0x000066, 0x330066, 0x003366, 0x333366, 0x660066, 0x663366, 0x990066, 0x993366,
+    0xCC0066, 0xFF0066, 0xCC3366, 0xFF3366, 0x006666, 0x336666, 0x666666, 0x996666,
+    0xCC6666, 0xFF6666, 0x009966, 0x339966, 0x669966, 0x999966, 0xCC9966, 0xFF9966,
+    0x00CC66, 0x33CC66, 0x00FF66, 0x33FF66, 0x66CC66, 0x66FF66, 0x99CC66, 0x99FF66,
+    0xCCCC66, 0xFFCC66, 0xCCFF66, 0xFFFF66, 0x000099, 0x330099, 0x003399, 0x333399,
+    0x660099, 0x663399, 0x990099, 0x993399, 0xCC0099, 0xFF0099, 0xCC3399, 0xFF3399,
+    0x006699, 0x336699, 0x666699, 0x996699, 0xCC6699, 0xFF6699, 0x009999, 0x339999,
+    0x669999, 0x999999, 0xCC9999, 0xFF9999, 0x00CC99, 0x33CC99, 0x00FF99, 0x33FF99,
+    0x66CC99, 0x66FF99, 0x99CC99, 0x99FF99, 0xCCCC99, 0xFFCC99, 0xCCFF99, 0xFFFF99,
+    0x0000CC, 0x3300CC, 0x0033CC, 0x3333CC, 0x0000FF, 0x3300FF, 0x0033FF, 0x3333FF,
+    0x6600CC, 0x6633CC, 0x6600FF, 0x6633FF, 0x9900CC, 0x9933CC, 0x9900FF, 0x9933FF,
+    0xCC00CC, 0xFF00CC, 0xCC33CC, 0xFF33CC, 0xCC00FF, 0xFF00FF, 0xCC33FF, 0xFF33FF,
+    0x0066CC, 0x3366CC, 0x0066FF, 0x3366FF, 0x6666CC, 0x6666FF, 0x9966CC, 0x9966FF,
+    0xCC66CC, 0xFF66CC, 0xCC66FF, 0xFF66FF, 0x0099CC, 0x3399CC, 0x0099FF, 0x3399FF,
+    0x6699CC, 0x6699FF, 0x9999CC, 0x9999FF, 0xCC99CC, 0xFF99CC, 0xCC99FF, 0xFF99FF,
+    0x00CCCC, 0x33CCCC, 0x00FFCC, 0x33FFCC, 0x00CCFF, 0x33CCFF, 0x00FFFF, 0x33FFFF,
+    0x66CCCC, 0x66FFCC, 0x66CCFF, 0x66FFFF, 0x99CCCC, 0x99FFCC, 0x99CCFF, 0x99FFFF,
+    0xCCCCCC, 0xFFCCCC, 0xCCFFCC, 0xFFFFCC, 0xCCCCFF, 0xFFCCFF, 0xCCFFFF, 0xFFFFFF,
+};
+
+static const uint16_t libraryId[216] =
+{
+    5, 6, 11, 12, 41, 42, 47, 48, 7, 13, 43, 49,
+    8, 14, 44, 50, 9, 10, 15, 16, 45, 46, 51, 52,
+    17, 18, 53, 54, 19, 55, 20, 56, 21, 22, 57, 58,
+    23, 24, 59, 60, 25, 61, 26, 62, 27, 28, 63, 64,
+    29, 30, 35, 36, 65, 66, 71, 72, 31, 37, 67, 73,
+    32, 38, 68, 74, 33, 34, 39, 40, 69, 70, 75, 76,
+    77, 78, 83, 84, 79, 85, 80, 86, 81, 82, 87, 88,
+    89, 90, 91, 92, 93, 94, 95, 96, 97, 98, 99, 100,
+    101, 102, 107, 108, 103, 109, 104, 110, 105, 106, 111, 112,
+    113, 114, 119, 120, 115, 121, 116, 122, 117, 118, 123, 124,
+    125, 126, 127, 128, 129, 130, 131, 132, 133, 134, 135, 136,
+    137, 138, 143, 144, 139, 145, 140, 146, 141, 142, 147, 148,
+    149, 150, 155, 156, 185, 186, 191, 192, 151, 157, 187, 193,
+    152, 158, 188, 194, 153, 154, 159, 160, 189, 190, 195, 196,
+    161, 162, 197, 198, 163, 199, 164, 200, 165, 166, 201, 202,
+    167, 168, 203, 204, 169, 205, 170, 206, 171, 172, 207, 208,
+    173, 174, 179, 180, 209, 210, 215, 216, 175, 181, 211, 217,
+    176, 182, 212, 218, 177, 178, 183, 184, 213, 214, 219, 220,
+};
+
+static const uint16_t libraryCellStart[65] =
+{
+    0, 8, 12, 16, 24, 28, 30, 32, 36, 40, 42, 44,
+    48, 56, 60, 64, 72, 76, 78, 80, 84, 86, 87, 88,
+    90, 92, 93, 94, 96, 100, 102, 104, 108, 112, 114, 116,
+    120, 122, 123, 124, 126, 128, 129, 130, 132, 136, 138, 140,
+    144, 152, 156, 160, 168, 172, 174, 176, 180, 184, 186, 188,
+    192, 200, 204, 208, 216,
+};
+
+const struct library referenceLibrary = {libraryRgb, libraryId, libraryCellStart, 216, 2};
@@ -0,0 +1,678 @@
+// Measurement functions
+// Interrupt-driven red, green, blue measurement sequence
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Each phase lights one LED and starts the one-shot settle timer (Timer2A).
+// The timer interrupt starts an ADC0 SS3 conversion and the SS3 interrupt
+// stores the sample and moves to the next phase, so the CPU is free while the
+// LEDs settle. Completed triplets are queued for the main loop, which does the
+// matching and formatting.
+//
+// Each phase can take a burst of up to 8 conversions on SS0 (one interrupt for
+// the whole FIFO) instead of a single SS3 conversion, and every conversion can
+// itself be averaged by the ADC hardware (ADC0_SAC_R, up to 64x). Results keep
+// their full resolution as 16-bit values.
+//
+// The settle time is either fixed, learned per LED during calibration, or
+// adaptive: the phase polls SS3 every SETTLE_POLL_US and takes its sample once
+// two successive conversions are within the tolerance, giving up at SETTLE_US.
+// For a first order response polled every 250 us with a 400 us time constant,
+// the error left when the steps agree to 4 counts is about twice that.
+//
+// An optional dark phase samples with all LEDs off and its value (ambient
+// light plus ADC offset) is subtracted from each channel. It only runs every
+// N triplets, since ambient changes slowly compared to the sequence rate.
+//
+//   IDLE -> [BLINK] -> [DARK] -> RED -> GREEN -> BLUE -> IDLE
+//
+// In continuous mode the BLUE phase goes straight back to the first LED phase
+// and every triplet is handed to a sink function in the SS3/SS0 interrupt, so
+// the sequence runs back-to-back at the rate the settle times allow.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hal.h"
+#include "wait.h"
+#include "measure.h"
+#include "profile.h"
+
+#define PHASE_IDLE      0
+#define PHASE_BLINK     1
+#define PHASE_RED       2
+#define PHASE_GREEN     3
+#define PHASE_BLUE      4
+#define PHASE_DARK      5
+
+#define CLOCKS_PER_US   (SYSTEM_CLOCK / 1000000)
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static volatile uint8_t phase = PHASE_IDLE;
+static uint16_t ledPwm[3];                  // pwm of each LED for this sequence
+static uint16_t sample[3];
+static uint8_t averageLog2 = 0;             // hardware averaging 2^n, 0-6
+static uint8_t burstLog2 = 0;               // conversions per phase 2^n, 0-3
+static volatile bool syncRequest = false;   // result goes to measureRgb, not the queue
+static volatile bool syncDone = false;
+
+static uint8_t settleMode = SETTLE_LEARNED;
+static uint16_t settleTolerance = SETTLE_TOLERANCE;
+static uint32_t learnedSettle[3] = {SETTLE_US, SETTLE_US, SETTLE_US};
+static uint32_t lastSettle[3];              // adaptive: us until each LED settled
+static volatile uint32_t settleTimeouts = 0;
+static bool settling = false;               // adaptive: polling, not sampling yet
+static bool havePoll;
+static uint16_t lastPoll;
+static uint32_t phaseStart;                 // cycle count when the LED changed
+static uint32_t sampleStart;                // cycle count when the conversion started
+static uint32_t sequenceStart;              // cycle count when the first LED phase started
+static volatile bool ss3Pending = false;    // a conversion of this sequence is running
+static volatile bool ss0Pending = false;
+static volatile uint8_t ss3Stale = 0;       // interrupts still due from stopped sequences
+static volatile uint8_t ss0Stale = 0;
+
+static uint16_t darkInterval = 0;           // triplets per dark refresh, 0 = off
+static uint16_t darkAge = 0;                // triplets since the last refresh
+static bool darkValid = false;
+static uint16_t dark = 0;
+static uint16_t darkMin;
+static uint16_t darkMax;
+static uint32_t darkRefreshes = 0;
+static uint32_t darkChanges = 0;            // refreshes that moved more than DARK_CHANGE
+static uint16_t darkLargestStep = 0;
+
+static uint16_t queue[TRIPLET_QUEUE][3];
+static uint32_t queueTime[TRIPLET_QUEUE];   // cycle counter when the triplet completed
+static volatile uint8_t queueWrite = 0;
+static volatile uint8_t queueRead = 0;
+static volatile uint8_t queueCount = 0;
+static volatile uint32_t skipped = 0;       // started while a sequence was running
+static volatile uint32_t dropped = 0;       // completed with the queue full
+static void (*continuousSink)(const uint16_t* rgb, uint32_t cycles) = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static uint32_t maxLearnedSettle()
+{
+    uint32_t us = learnedSettle[0];
+
+    if (learnedSettle[1] > us)
+        us = learnedSettle[1];
+    if (learnedSettle[2] > us)
+        us = learnedSettle[2];
+    return us;
+}
+
+static void startPhase(uint8_t next)
+{
+    phase = next;
+    switch (next)
+    {
+    case PHASE_RED:
+        setRgbColor(ledPwm[0], 0, 0);
+        break;
+    case PHASE_GREEN:
+        setRgbColor(0, ledPwm[1], 0);
+        break;
+    case PHASE_BLUE:
+        setRgbColor(0, 0, ledPwm[2]);
+        break;
+    case PHASE_DARK:
+        setRgbColor(0, 0, 0);
+        break;
+    }
+    phaseStart = readCycleCounter();
+    if (settleMode == SETTLE_ADAPTIVE)
+    {
+        settling = true;
+        havePoll = false;
+        startSettleTimer(SETTLE_POLL_US);
+    }
+    else if (settleMode == SETTLE_LEARNED && next == PHASE_DARK)
+        startSettleTimer(maxLearnedSettle());
+    else if (settleMode == SETTLE_LEARNED)
+        startSettleTimer(learnedSettle[next - PHASE_RED]);
+    else
+        startSettleTimer(SETTLE_US);
+}
+
+// First phase with the LEDs on, after a dark refresh if one is due
+static void startLedPhases()
+{
+    sequenceStart = profileStart(PROFILE_SEQUENCE);
+    if (darkInterval != 0 && (!darkValid || darkAge >= darkInterval))
+        startPhase(PHASE_DARK);
+    else
+        startPhase(PHASE_RED);
+}
+
+static void storeDark(uint16_t value)
+{
+    uint16_t step = value > dark ? value - dark : dark - value;
+
+    if (!darkValid)
+    {
+        darkMin = darkMax = value;
+        step = 0;
+    }
+    if (value < darkMin)
+        darkMin = value;
+    if (value > darkMax)
+        darkMax = value;
+    if (step > DARK_CHANGE)
+        darkChanges++;
+    if (step > darkLargestStep)
+        darkLargestStep = step;
+    dark = value;
+    darkValid = true;
+    darkAge = 0;
+    darkRefreshes++;
+}
+
+// Starts a conversion that belongs to the running sequence
+static void startConversion(bool burst)
+{
+    sampleStart = profileStart(PROFILE_ADC);
+    if (burst)
+    {
+        ss0Pending = true;
+        startAdc0Ss0(1 << burstLog2);
+    }
+    else
+    {
+        ss3Pending = true;
+        startAdc0Ss3();
+    }
+}
+
+// Starts the sample of the current phase once its LED has settled
+static void startSample()
+{
+    startConversion(burstLog2 != 0);
+}
+
+static void finishSequence()
+{
+    uint8_t i;
+
+    setRgbColor(0, 0, 0);
+    profileEnd(PROFILE_SEQUENCE, sequenceStart);
+    if (darkInterval != 0)
+    {
+        for (i = 0; i < 3; i++)
+            sample[i] = sample[i] > dark ? sample[i] - dark : 0;
+        darkAge++;
+    }
+    if (syncRequest)
+    {
+        syncRequest = false;
+        syncDone = true;
+    }
+    else if (continuousSink)
+    {
+        continuousSink(sample, readCycleCounter());
+        startLedPhases();
+        return;
+    }
+    else if (queueCount == TRIPLET_QUEUE)
+        dropped++;
+    else
+    {
+        queue[queueWrite][0] = sample[0];
+        queue[queueWrite][1] = sample[1];
+        queue[queueWrite][2] = sample[2];
+        queueTime[queueWrite] = readCycleCounter();
+        queueWrite = (queueWrite + 1) % TRIPLET_QUEUE;
+        queueCount++;
+    }
+    phase = PHASE_IDLE;
+}
+
+static bool startSequence(const uint32_t* pwm, bool blink, bool sync)
+{
+    uint32_t state = disableInterrupts();
+
+    if (phase != PHASE_IDLE)
+    {
+        if (!sync)
+            skipped++;
+        restoreInterrupts(state);
+        return false;
+    }
+    syncRequest = sync;
+    ledPwm[0] = pwm[0];
+    ledPwm[1] = pwm[1];
+    ledPwm[2] = pwm[2];
+    if (blink)
+    {
+        setGreenLed(true);
+        phase = PHASE_BLINK;
+        startSettleTimer(BLINK_US);
+    }
+    else
+        startLedPhases();
+    restoreInterrupts(state);
+    return true;
+}
+
+// Starts a sequence with the given red, green, blue pwm values; returns false
+// (and counts a skip) if one is already running. Safe to call from an ISR.
+bool startMeasurement(const uint32_t* pwm, bool blink)
+{
+    return startSequence(pwm, blink, false);
+}
+
+// Runs sequences back-to-back, passing each triplet and the cycle counter value
+// when it completed to sink, from the interrupt; stopMeasurement() ends it.
+// Returns false if a sequence is already running.
+bool startContinuous(const uint32_t* pwm, void (*sink)(const uint16_t* rgb, uint32_t cycles))
+{
+    uint32_t state = disableInterrupts();
+
+    if (phase != PHASE_IDLE)
+    {
+        restoreInterrupts(state);
+        return false;
+    }
+    continuousSink = sink;
+    ledPwm[0] = pwm[0];
+    ledPwm[1] = pwm[1];
+    ledPwm[2] = pwm[2];
+    startLedPhases();
+    restoreInterrupts(state);
+    return true;
+}
+
+bool isContinuous()
+{
+    return continuousSink != 0;
+}
+
+// Aborts a running sequence and turns the LEDs off
+void stopMeasurement()
+{
+    uint32_t state = disableInterrupts();
+    continuousSink = 0;
+    stopSettleTimer();
+    settling = false;
+    if (ss3Pending)                         // its interrupt must not land in the next sequence
+        ss3Stale++;
+    if (ss0Pending)
+        ss0Stale++;
+    ss3Pending = ss0Pending = false;
+    if (phase != PHASE_IDLE)
+    {
+        setRgbColor(0, 0, 0);
+        setGreenLed(false);
+        phase = PHASE_IDLE;
+    }
+    if (syncRequest)
+    {
+        syncRequest = false;
+        syncDone = true;
+    }
+    restoreInterrupts(state);
+}
+
+bool isMeasuring()
+{
+    return phase != PHASE_IDLE;
+}
+
+// Non-blocking, returns the oldest completed triplet
+bool getTriplet(uint16_t* red, uint16_t* green, uint16_t* blue)
+{
+    uint32_t time;
+
+    return getTimedTriplet(red, green, blue, &time);
+}
+
+// As getTriplet, with the cycle counter value when the triplet completed
+bool getTimedTriplet(uint16_t* red, uint16_t* green, uint16_t* blue, uint32_t* time)
+{
+    uint32_t state;
+
+    if (queueCount == 0)
+        return false;
+    *red = queue[queueRead][0];
+    *green = queue[queueRead][1];
+    *blue = queue[queueRead][2];
+    *time = queueTime[queueRead];
+    state = disableInterrupts();
+    queueRead = (queueRead + 1) % TRIPLET_QUEUE;
+    queueCount--;
+    restoreInterrupts(state);
+    return true;
+}
+
+bool isTripletPending()
+{
+    return queueCount > 0;
+}
+
+// Blocking measurement for the foreground commands; waits for a running
+// sequence to finish, then runs one of its own
+void measureRgb(const uint32_t* pwm, uint16_t* red, uint16_t* green, uint16_t* blue)
+{
+    uint32_t state;
+
+    // tested with interrupts masked, so the interrupt that ends the sequence
+    // cannot run between the test and the WFI and leave nothing to wake it
+    syncDone = false;
+    while (!startSequence(pwm, false, true))
+    {
+        state = disableInterrupts();
+        if (isMeasuring())
+            waitForInterrupt();
+        restoreInterrupts(state);
+    }
+    while (!syncDone)
+    {
+        state = disableInterrupts();
+        if (!syncDone)
+            waitForInterrupt();
+        restoreInterrupts(state);
+    }
+    *red = sample[0];
+    *green = sample[1];
+    *blue = sample[2];
+}
+
+// Hardware averaging (1, 2, 4 ... 64) of every conversion and the number of
+// conversions per LED phase (1, 2, 4 or 8); other values round down
+void setAcquisition(uint8_t average, uint8_t burst)
+{
+    uint8_t newAverage = 0, newBurst = 0;
+    uint32_t state;
+
+    while (newAverage < 6 && (2 << newAverage) <= average)
+        newAverage++;
+    while (newBurst < 3 && (2 << newBurst) <= burst)
+        newBurst++;
+    while (isMeasuring())                   // a burst in flight is scaled by the old count
+    {
+        state = disableInterrupts();
+        if (isMeasuring())
+            waitForInterrupt();
+        restoreInterrupts(state);
+    }
+    averageLog2 = newAverage;
+    burstLog2 = newBurst;
+    setAdcAveraging(averageLog2);
+}
+
+// Fixed, learned or adaptive settling; applies from the next phase
+void setSettleMode(uint8_t mode)
+{
+    if (mode <= SETTLE_ADAPTIVE)
+        settleMode = mode;
+}
+
+uint8_t getSettleMode()
+{
+    return settleMode;
+}
+
+// Largest change between successive adaptive settle checks, in 12-bit counts
+void setSettleTolerance(uint16_t counts)
+{
+    settleTolerance = counts;
+}
+
+uint16_t getSettleTolerance()
+{
+    return settleTolerance;
+}
+
+// Per-LED settle times in us for the learned mode, limited to SETTLE_US
+void setLearnedSettle(const uint32_t* us)
+{
+    uint8_t i;
+
+    for (i = 0; i < 3; i++)
+    {
+        learnedSettle[i] = us[i];
+        if (learnedSettle[i] < SETTLE_POLL_US)
+            learnedSettle[i] = SETTLE_POLL_US;
+        if (learnedSettle[i] > SETTLE_US)
+            learnedSettle[i] = SETTLE_US;
+    }
+}
+
+void getLearnedSettle(uint32_t* us)
+{
+    us[0] = learnedSettle[0];
+    us[1] = learnedSettle[1];
+    us[2] = learnedSettle[2];
+}
+
+// Settle times of the last adaptive sequence
+void getLastSettle(uint32_t* us)
+{
+    us[0] = lastSettle[0];
+    us[1] = lastSettle[1];
+    us[2] = lastSettle[2];
+}
+
+// Adaptive phases that reached SETTLE_US without settling
+uint32_t getSettleTimeouts()
+{
+    return settleTimeouts;
+}
+
+// Learns SETTLE_MARGIN times the adaptive settle time of each LED stepping
+// from dark to its pwm value, the largest step a measurement makes. Returns
+// false if an LED did not settle.
+bool learnSettle(const uint32_t* pwm)
+{
+    uint8_t mode = settleMode;
+    uint32_t timeouts = settleTimeouts;
+    uint32_t one[3];
+    uint32_t us[3];
+    uint16_t red, green, blue;
+    uint8_t i;
+
+    settleMode = SETTLE_ADAPTIVE;
+    for (i = 0; i < 3; i++)
+    {
+        one[0] = one[1] = one[2] = 0;
+        one[i] = pwm[i];
+        setRgbColor(0, 0, 0);
+        waitMicrosecond(SETTLE_US);
+        measureRgb(one, &red, &green, &blue);
+        us[i] = lastSettle[i] * SETTLE_MARGIN;
+    }
+    settleMode = mode;
+    setLearnedSettle(us);
+    return settleTimeouts == timeouts;
+}
+
+// Refreshes the dark value every n triplets and subtracts it, 0 turns it off
+void setDarkInterval(uint16_t triplets)
+{
+    darkInterval = triplets;
+    darkAge = 0;
+    darkValid = false;
+}
+
+uint16_t getDarkInterval()
+{
+    return darkInterval;
+}
+
+// Dark values are 16-bit samples like the triplets
+uint16_t getDark()
+{
+    return dark;
+}
+
+uint16_t getDarkMin()
+{
+    return darkMin;
+}
+
+uint16_t getDarkMax()
+{
+    return darkMax;
+}
+
+uint32_t getDarkRefreshes()
+{
+    return darkRefreshes;
+}
+
+// Refreshes that differed from the previous dark value by more than DARK_CHANGE
+uint32_t getDarkChanges()
+{
+    return darkChanges;
+}
+
+uint16_t getDarkLargestStep()
+{
+    return darkLargestStep;
+}
+
+void resetDarkStats()
+{
+    uint32_t state = disableInterrupts();
+    darkMin = darkMax = dark;
+    darkRefreshes = 0;
+    darkChanges = 0;
+    darkLargestStep = 0;
+    restoreInterrupts(state);
+}
+
+uint8_t getAverage()
+{
+    return 1 << averageLog2;
+}
+
+uint8_t getBurst()
+{
+    return 1 << burstLog2;
+}
+
+uint32_t getMeasurementsSkipped()
+{
+    return skipped;
+}
+
+uint32_t getTripletsDropped()
+{
+    return dropped;
+}
+
+// Timer2A one-shot: the LED has settled (or the blink is over)
+void settleTimerIsr()
+{
+    clearSettleTimerInt();
+    if (phase == PHASE_BLINK)
+    {
+        setGreenLed(false);
+        startLedPhases();
+    }
+    else if (settling)
+        startConversion(false);             // poll, the sample if it has settled
+    else if (phase != PHASE_IDLE)
+        startSample();
+}
+
+// Adaptive settle check; returns true once the LED has settled
+static bool checkSettled(uint16_t raw)
+{
+    uint32_t elapsed = (readCycleCounter() - phaseStart) / CLOCKS_PER_US;
+    bool settled = havePoll && raw <= lastPoll + settleTolerance && lastPoll <= raw + settleTolerance;
+
+    if (!settled && elapsed + SETTLE_POLL_US > SETTLE_US)
+    {
+        settleTimeouts++;
+        settled = true;
+    }
+    if (settled)
+    {
+        settling = false;
+        if (phase != PHASE_DARK)
+            lastSettle[phase - PHASE_RED] = elapsed;
+        return true;
+    }
+    havePoll = true;
+    lastPoll = raw;
+    startSettleTimer(SETTLE_POLL_US);
+    return false;
+}
+
+static void storeSample(uint16_t value)
+{
+    if (phase < PHASE_RED)
+        return;
+    profileAdd(PROFILE_SETTLE + phase - PHASE_RED, sampleStart - phaseStart);   // red, green, blue, dark
+    profileEnd(PROFILE_ADC + phase - PHASE_RED, sampleStart);
+    if (phase == PHASE_DARK)
+    {
+        storeDark(value);
+        startPhase(PHASE_RED);
+        return;
+    }
+    sample[phase - PHASE_RED] = value;
+    if (phase == PHASE_BLUE)
+        finishSequence();
+    else
+        startPhase(phase + 1);
+}
+
+// ADC0 SS3 conversion complete
+void adc0Ss3Isr()
+{
+    uint16_t raw = readAdc0Ss3Result();
+
+    if (ss3Stale != 0)                      // started before stopMeasurement()
+    {
+        ss3Stale--;
+        return;
+    }
+    ss3Pending = false;
+    if (settling)
+    {
+        if (!checkSettled(raw))
+            return;
+        if (burstLog2 != 0)
+        {
+            startSample();
+            return;
+        }
+    }
+    storeSample(raw << 4);                  // the settled conversion is the sample
+}
+
+// ADC0 SS0 burst complete, sum of 2^n 12-bit conversions scaled to 16 bits
+void adc0Ss0Isr()
+{
+    uint16_t raw[MAX_BURST];
+    uint32_t sum = 0;
+    uint8_t i, count;
+
+    count = readAdc0Ss0Results(raw);
+    if (ss0Stale != 0)
+    {
+        ss0Stale--;
+        return;
+    }
+    ss0Pending = false;
+    for (i = 0; i < count; i++)
+        sum += raw[i];
+    storeSample((sum << 4) >> burstLog2);
+}
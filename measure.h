@@ -0,0 +1,77 @@
+// Measurement functions
+// Interrupt-driven red, green, blue measurement sequence
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef MEASURE_H_
+#define MEASURE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SETTLE_US       10000       // LED settle time before each sample (fixed mode, upper bound)
+#define SETTLE_POLL_US  250         // adaptive mode: time between settle checks
+#define SETTLE_TOLERANCE 4          // adaptive mode: 12-bit counts between successive checks
+#define SETTLE_MARGIN   2           // learned settle = margin x measured settle
+
+#define SETTLE_FIXED    0           // SETTLE_US for every LED
+#define SETTLE_LEARNED  1           // per-LED times learned during calibration
+#define SETTLE_ADAPTIVE 2           // sample until successive readings agree
+
+#define DARK_CHANGE     (4 << 4)    // dark refresh that counts as an ambient change
+
+#define BLINK_US        5000        // on-board LED flash for "led sample"
+#define TRIPLET_QUEUE   8           // completed triplets waiting for the main loop
+#define MAX_BURST       8           // SS0 FIFO depth
+
+// Samples are 16-bit oversampled values (12-bit conversions << 4, or the sum of
+// a burst scaled to 16 bits). Reduce them only where they are reported.
+#define TO_12BIT(x)     ((x) >> 4)
+#define TO_8BIT(x)      ((x) >> 7)  // 11-bit full scale (T) to 8 bits
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+bool startMeasurement(const uint32_t* pwm, bool blink);
+bool startContinuous(const uint32_t* pwm, void (*sink)(const uint16_t* rgb, uint32_t cycles));
+bool isContinuous();
+void stopMeasurement();
+bool isMeasuring();
+bool getTriplet(uint16_t* red, uint16_t* green, uint16_t* blue);
+bool getTimedTriplet(uint16_t* red, uint16_t* green, uint16_t* blue, uint32_t* time);
+bool isTripletPending();
+void measureRgb(const uint32_t* pwm, uint16_t* red, uint16_t* green, uint16_t* blue);
+void setAcquisition(uint8_t average, uint8_t burst);
+void setSettleMode(uint8_t mode);
+uint8_t getSettleMode();
+void setSettleTolerance(uint16_t counts);
+uint16_t getSettleTolerance();
+void setLearnedSettle(const uint32_t* us);
+void getLearnedSettle(uint32_t* us);
+void getLastSettle(uint32_t* us);
+uint32_t getSettleTimeouts();
+bool learnSettle(const uint32_t* pwm);
+void setDarkInterval(uint16_t triplets);
+uint16_t getDarkInterval();
+uint16_t getDark();
+uint16_t getDarkMin();
+uint16_t getDarkMax();
+uint32_t getDarkRefreshes();
+uint32_t getDarkChanges();
+uint16_t getDarkLargestStep();
+void resetDarkStats();
+uint8_t getAverage();
+uint8_t getBurst();
+uint32_t getMeasurementsSkipped();
+uint32_t getTripletsDropped();
+void settleTimerIsr();
+void adc0Ss3Isr();
+void adc0Ss0Isr();
+
+#endif
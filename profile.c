@@ -0,0 +1,113 @@
+// Profile functions
+// Cycle-counter timing of the measurement and reporting phases
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Each phase keeps a count, min, max, total and a histogram of its duration in
+// system clocks, with power-of-2 buckets so one array covers 1 clock to 107 s.
+// A sample costs two counter reads and a few adds, cheap enough to leave on in
+// the ISRs. Settle and ADC time are kept per LED phase (red, green, blue,
+// dark), since the settle time is learned per LED.
+//
+// On the target both clocks are the DWT cycle counter (CYCCNT). In the host
+// build the hardware phases (settle, ADC, sequence, latency) follow the
+// simulated clock, readCycleCounter(), since that is the time being modeled,
+// and the CPU phases follow host time through readCpuCycles(), which uses the
+// monotonic clock.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hal.h"
+#include "profile.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static struct profileStats stats[PROFILE_PHASES];
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static bool isCpuPhase(uint8_t phase)
+{
+    return phase >= PROFILE_FORMAT;
+}
+
+// Counter value to pass to profileEnd() when the phase is over
+uint32_t profileStart(uint8_t phase)
+{
+    return isCpuPhase(phase) ? readCpuCycles() : readCycleCounter();
+}
+
+void profileEnd(uint8_t phase, uint32_t start)
+{
+    profileAdd(phase, profileStart(phase) - start);
+}
+
+// Records a duration measured elsewhere, in system clocks
+void profileAdd(uint8_t phase, uint32_t cycles)
+{
+    struct profileStats* s = &stats[phase];
+    uint8_t bucket = 0;
+    uint32_t state;
+
+    while (bucket < PROFILE_BUCKETS - 1 && (cycles >> (bucket + 1)) != 0)
+        bucket++;
+    state = disableInterrupts();            // ISRs and the main loop both add
+    if (s->count == 0 || cycles < s->min)
+        s->min = cycles;
+    if (cycles > s->max)
+        s->max = cycles;
+    s->total += cycles;
+    s->count++;
+    if (s->buckets[bucket] != 0xFFFF)
+        s->buckets[bucket]++;
+    restoreInterrupts(state);
+}
+
+void resetProfile()
+{
+    uint32_t state = disableInterrupts();
+    uint8_t i, j;
+
+    for (i = 0; i < PROFILE_PHASES; i++)
+    {
+        stats[i].count = stats[i].min = stats[i].max = 0;
+        stats[i].total = 0;
+        for (j = 0; j < PROFILE_BUCKETS; j++)
+            stats[i].buckets[j] = 0;
+    }
+    restoreInterrupts(state);
+}
+
+// Copy of a phase's statistics; false if it has not run since the reset
+bool getProfile(uint8_t phase, struct profileStats* copy)
+{
+    uint32_t state;
+
+    if (phase >= PROFILE_PHASES || stats[phase].count == 0)
+        return false;
+    state = disableInterrupts();
+    *copy = stats[phase];
+    restoreInterrupts(state);
+    return true;
+}
+
+const char* getProfileName(uint8_t phase)
+{
+    static const char* names[PROFILE_PHASES] = {"settle R", "settle G", "settle B", "settle D",
+                                                "adc R", "adc G", "adc B", "adc D", "sequence",
+                                                "latency", "format", "uart", "match", "delta", "eeprom"};
+    return phase < PROFILE_PHASES ? names[phase] : "?";
+}
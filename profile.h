@@ -0,0 +1,55 @@
+// Profile functions
+// Cycle-counter timing of the measurement and reporting phases
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PROFILE_SETTLE      0       // LED on until its sample starts, + PROFILE_RED ...
+#define PROFILE_ADC         4       // sample start until the conversion interrupt, + PROFILE_RED ...
+#define PROFILE_SEQUENCE    8       // first LED on until the triplet is complete
+#define PROFILE_LATENCY     9       // triplet complete until the main loop takes it
+#define PROFILE_FORMAT      10      // text of a reported triplet
+#define PROFILE_UART        11      // putsUart0 of a reported triplet
+#define PROFILE_MATCH       12      // match()
+#define PROFILE_DELTA       13      // delta()
+#define PROFILE_EEPROM      14      // color store write of colorN
+#define PROFILE_PHASES      15
+
+// Offsets of the per-LED settle and ADC entries
+#define PROFILE_RED         0
+#define PROFILE_GREEN       1
+#define PROFILE_BLUE        2
+#define PROFILE_DARK        3
+#define PROFILE_BUCKETS     32      // histogram bucket n: 2^n to 2^(n+1) - 1 cycles, 0 in bucket 0
+
+struct profileStats
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint16_t buckets[PROFILE_BUCKETS];  // saturate at 65535
+};
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint32_t profileStart(uint8_t phase);
+void profileEnd(uint8_t phase, uint32_t start);
+void profileAdd(uint8_t phase, uint32_t cycles);
+void resetProfile();
+bool getProfile(uint8_t phase, struct profileStats* stats);
+const char* getProfileName(uint8_t phase);
+
+#endif
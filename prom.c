@@ -0,0 +1,287 @@
+// Persistent store functions
+// Versioned EEPROM layout header and A/B calibration slots
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// EEPROM layout, version 3:
+//
+//   blocks 0-15  color record store (store.c), segments commit with a header
+//   block 16     calibration slot A
+//   block 17     calibration slot B
+//   block 18     layout header: magic, version, section table, CRC
+//   blocks 20-31 command scripts (script.c)
+//
+// A calibration slot is magic, sequence, pwm[3], settle[3] and a CRC of the
+// words before it. A save programs the slot that is not in use, reads it back
+// and only then makes it current, so a torn write leaves the previous
+// calibration in place. Boot takes the valid slot with the higher sequence.
+//
+// Version 1 had no header, the calibration at 0x400 followed by the settle
+// times at 0x40C, validity guessed from erased words. Without a header, that
+// calibration is copied into slot B (slot A holds the old words and fails its
+// magic check) and the header is written. A header with a newer version is
+// not interpreted and nothing is written. Version 2 is version 3 without the
+// scripts section; only its header is rewritten, as the scripts check their
+// own magic and CRC.
+//
+// Boot reads the header and both slots, 24 words; the colors are replayed
+// from their store on first use (colors.c).
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "eeprom.h"
+#include "crc.h"
+#include "prom.h"
+
+#define NO_SLOT         0xFF
+#define LEGACY_SETTLE   0x40C
+#define V2_SECTIONS     3
+
+struct promSection
+{
+    uint16_t address;
+    uint16_t words;
+};
+
+struct promHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    struct promSection section[PROM_SECTIONS];
+    uint32_t crc;
+};
+
+struct calibrationSlot
+{
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t pwm[3];
+    uint32_t settle[3];
+    uint32_t crc;
+};
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static const struct promHeader layout =
+{
+    PROM_MAGIC, PROM_VERSION,
+    {
+        {PROM_COLORS_ADDRESS, 256},
+        {PROM_CAL_A_ADDRESS, sizeof(struct calibrationSlot) / 4},
+        {PROM_CAL_B_ADDRESS, sizeof(struct calibrationSlot) / 4},
+        {PROM_SCRIPTS_ADDRESS, PROM_SCRIPTS_WORDS}
+    },
+    0
+};
+
+static const uint16_t slotAddress[2] = {PROM_CAL_A_ADDRESS, PROM_CAL_B_ADDRESS};
+
+static bool ready = false;
+static bool writable = false;
+static uint8_t activeSlot = NO_SLOT;
+static uint32_t activeSequence = 0;
+static uint32_t crcErrors = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// EEPROMInit with a bounded number of retries
+bool initProm()
+{
+    uint8_t i;
+
+    for (i = 0; i < PROM_INIT_RETRIES && !ready; i++)
+        ready = EEPROMInit() == EEPROM_INIT_OK;
+    return ready;
+}
+
+static uint32_t slotCrc(const struct calibrationSlot* slot)
+{
+    return crc32(0, slot, offsetof(struct calibrationSlot, crc));
+}
+
+static uint8_t readSlot(uint8_t n, struct calibrationSlot* slot)
+{
+    EEPROMRead((uint32_t*)slot, slotAddress[n], sizeof(*slot));
+    if (slot->magic != CAL_MAGIC)
+        return SLOT_EMPTY;
+    if (slotCrc(slot) != slot->crc)
+        return SLOT_CORRUPT;
+    return SLOT_VALID;
+}
+
+static bool writeSlot(uint8_t n, const uint32_t* pwm, const uint32_t* settle, uint32_t sequence)
+{
+    struct calibrationSlot slot, check;
+    uint8_t i;
+
+    slot.magic = CAL_MAGIC;
+    slot.sequence = sequence;
+    for (i = 0; i < 3; i++)
+    {
+        slot.pwm[i] = pwm[i];
+        slot.settle[i] = settle[i];
+    }
+    slot.crc = slotCrc(&slot);
+    if (EEPROMProgram((uint32_t*)&slot, slotAddress[n], sizeof(slot)) != 0)
+        return false;
+    if (readSlot(n, &check) != SLOT_VALID || check.sequence != sequence)
+        return false;
+    activeSlot = n;
+    activeSequence = sequence;
+    return true;
+}
+
+// Picks the valid slot with the higher sequence
+static void findSlot()
+{
+    struct calibrationSlot slot;
+    uint8_t n, state;
+
+    activeSlot = NO_SLOT;
+    activeSequence = 0;
+    for (n = 0; n < 2; n++)
+    {
+        state = readSlot(n, &slot);
+        if (state == SLOT_CORRUPT)
+            crcErrors++;
+        if (state == SLOT_VALID && (activeSlot == NO_SLOT || slot.sequence > activeSequence))
+        {
+            activeSlot = n;
+            activeSequence = slot.sequence;
+        }
+    }
+}
+
+// Copies a version 1 calibration into slot B
+static bool migrateCalibration()
+{
+    uint32_t pwm[3], settle[3];
+
+    EEPROMRead(pwm, PROM_CAL_A_ADDRESS, sizeof(pwm));
+    EEPROMRead(settle, LEGACY_SETTLE, sizeof(settle));
+    if (pwm[0] == 0xFFFFFFFF && pwm[1] == 0xFFFFFFFF && pwm[2] == 0xFFFFFFFF)
+        return false;
+    if (settle[0] == 0xFFFFFFFF)
+        settle[0] = settle[1] = settle[2] = 0;
+    return writeSlot(1, pwm, settle, 1);
+}
+
+static bool writeHeader()
+{
+    struct promHeader header = layout;
+
+    header.crc = crc32(0, &header, offsetof(struct promHeader, crc));
+    return EEPROMProgram((uint32_t*)&header, PROM_HEADER_ADDRESS, sizeof(header)) == 0;
+}
+
+// True if the header's CRC checks out; version 2 had one section less, so
+// its CRC sits where the scripts section is now
+static bool isHeaderValid(const struct promHeader* header)
+{
+    const uint32_t* words = (const uint32_t*)header;
+    uint8_t crcWord = offsetof(struct promHeader, section) / 4 + V2_SECTIONS;
+
+    if (header->magic != PROM_MAGIC)
+        return false;
+    if (header->version == 2)
+        return words[crcWord] == crc32(0, header, crcWord * 4);
+    return header->version == PROM_VERSION && header->crc == crc32(0, header, offsetof(struct promHeader, crc));
+}
+
+// Reads the layout header and the calibration slot headers, formatting blank
+// or version 1 EEPROM
+uint8_t openProm()
+{
+    struct promHeader header;
+    uint8_t result = PROM_OK;
+
+    writable = false;
+    if (!ready)
+        return PROM_UNAVAILABLE;
+    EEPROMRead((uint32_t*)&header, PROM_HEADER_ADDRESS, sizeof(header));
+    // a newer header may be a different size, so its magic and version decide
+    if (header.magic == PROM_MAGIC && header.version > PROM_VERSION && header.version != 0xFFFFFFFF)
+        return PROM_NEWER;
+    writable = true;
+    if (!isHeaderValid(&header))
+    {
+        result = migrateCalibration() ? PROM_MIGRATED : PROM_FORMATTED;
+        writeHeader();
+    }
+    else if (header.version != PROM_VERSION)
+    {
+        result = PROM_UPGRADED;
+        writeHeader();
+    }
+    findSlot();
+    return result;
+}
+
+bool isPromWritable()
+{
+    return writable;
+}
+
+// Current calibration; false if neither slot is valid
+bool loadCalibration(uint32_t* pwm, uint32_t* settle)
+{
+    struct calibrationSlot slot;
+    uint8_t i;
+
+    if (activeSlot == NO_SLOT || readSlot(activeSlot, &slot) != SLOT_VALID)
+        return false;
+    for (i = 0; i < 3; i++)
+    {
+        pwm[i] = slot.pwm[i];
+        settle[i] = slot.settle[i];
+    }
+    return true;
+}
+
+// Commits a calibration to the slot not in use
+bool saveCalibration(const uint32_t* pwm, const uint32_t* settle)
+{
+    if (!writable)
+        return false;
+    return writeSlot(activeSlot == 0 ? 1 : 0, pwm, settle, activeSequence + 1);
+}
+
+uint8_t readCalibrationSlot(uint8_t n, uint32_t* pwm, uint32_t* settle, uint32_t* sequence)
+{
+    struct calibrationSlot slot;
+    uint8_t state, i;
+
+    state = readSlot(n, &slot);
+    for (i = 0; i < 3; i++)
+    {
+        pwm[i] = slot.pwm[i];
+        settle[i] = slot.settle[i];
+    }
+    *sequence = slot.sequence;
+    return state;
+}
+
+// Slot in use, 0 = A, 1 = B, 0xFF = none
+uint8_t getCalibrationSlot()
+{
+    return activeSlot;
+}
+
+uint32_t getPromCrcErrors()
+{
+    return crcErrors;
+}
@@ -0,0 +1,62 @@
+// Persistent store functions
+// Versioned EEPROM layout header and A/B calibration slots
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef PROM_H_
+#define PROM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PROM_MAGIC          0x50524F4D  // "PROM"
+#define PROM_VERSION        3           // 1 had no header: raw calibration at 0x400
+#define PROM_INIT_RETRIES   3
+
+#define PROM_COLORS_ADDRESS 0x000       // blocks 0-15, color record store
+#define PROM_CAL_A_ADDRESS  0x400       // block 16
+#define PROM_CAL_B_ADDRESS  0x440       // block 17
+#define PROM_HEADER_ADDRESS 0x480       // block 18
+#define PROM_SCRIPTS_ADDRESS 0x500      // blocks 20-31, command scripts
+#define PROM_SCRIPTS_WORDS  192
+
+#define PROM_SECTIONS       4
+#define SECTION_COLORS      0
+#define SECTION_CAL_A       1
+#define SECTION_CAL_B       2
+#define SECTION_SCRIPTS     3           // added in version 3
+
+// openProm results
+#define PROM_OK             0
+#define PROM_FORMATTED      1           // blank EEPROM, header written
+#define PROM_MIGRATED       2           // version 1 calibration moved into a slot
+#define PROM_NEWER          3           // written by newer firmware, left alone
+#define PROM_UNAVAILABLE    4           // EEPROMInit failed
+#define PROM_UPGRADED       5           // version 2 header rewritten as version 3
+
+#define CAL_MAGIC           0x43414C32  // "CAL2"
+
+// readCalibrationSlot results
+#define SLOT_EMPTY          0
+#define SLOT_VALID          1
+#define SLOT_CORRUPT        2           // magic present, CRC wrong (torn write)
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+bool initProm();
+uint8_t openProm();
+bool isPromWritable();
+bool loadCalibration(uint32_t* pwm, uint32_t* settle);
+bool saveCalibration(const uint32_t* pwm, const uint32_t* settle);
+uint8_t readCalibrationSlot(uint8_t slot, uint32_t* pwm, uint32_t* settle, uint32_t* sequence);
+uint8_t getCalibrationSlot();
+uint32_t getPromCrcErrors();
+
+#endif
@@ -0,0 +1,278 @@
+// Script functions
+// Command sequences stored in EEPROM as pre-tokenized steps
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// A script is a named list of steps, each one command line already looked up
+// and tokenized:
+//
+//   opcode          index of the command in commandTable
+//   shape           bits 0-2 argument count, bit 3+i set if argument i is a word
+//   arguments       numbers as base-128 varints (low 7 bits first, bit 7 set
+//                   on all but the last byte), words as a length byte and text
+//
+// so "match 20" is 3 bytes and "calibrate" 2. Replaying a step fills tokens[]
+// directly, with no lookup or number parsing.
+//
+// Four slots of three blocks each live in the scripts section of the EEPROM
+// layout (prom.h). A slot is a header (magic, command table signature,
+// length, step count, boot flag, name, CRC of header and code) followed by
+// the code. Opcodes are only meaningful for the table they were recorded
+// with, so a script whose signature differs from the running table's is
+// reported as stale and not run.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "eeprom.h"
+#include "crc.h"
+#include "prom.h"
+#include "uart0.h"
+#include "script.h"
+
+#define STEP_ARGS_MAX   4
+#define STEP_COUNT      0x07
+#define STEP_WORD       0x08        // shifted left by the argument number
+#define FLAG_BOOT       0x01
+
+struct scriptHeader
+{
+    uint32_t magic;
+    uint32_t signature;
+    uint16_t length;
+    uint8_t steps;
+    uint8_t flags;
+    char name[SCRIPT_NAME_MAX + 1];
+    uint32_t crc;
+};
+
+struct scriptSlot
+{
+    struct scriptHeader header;
+    uint8_t code[SCRIPT_CODE_MAX];
+};
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static uint32_t slotAddress(uint8_t slot)
+{
+    return PROM_SCRIPTS_ADDRESS + slot * SCRIPT_SLOT_WORDS * 4;
+}
+
+static uint32_t scriptCrc(const struct scriptSlot* image)
+{
+    uint32_t crc = crc32(0, &image->header, offsetof(struct scriptHeader, crc));
+    return crc32(crc, image->code, image->header.length);
+}
+
+// Appends one step for the fields of line; returns the bytes written, or 0
+// if they do not fit in space
+uint8_t encodeStep(uint8_t* code, uint16_t space, uint8_t opcode, const char* line,
+                   const struct token* tokens, uint8_t fieldCount)
+{
+    uint8_t args = fieldCount - 1;
+    uint16_t n = 2;
+    uint8_t i;
+
+    if(fieldCount == 0 || args > STEP_ARGS_MAX || space < 2)
+        return 0;
+    code[0] = opcode;
+    code[1] = args;
+    for(i = 0; i < args; i++)
+    {
+        const struct token* token = &tokens[i + 1];
+        if(token->kind == TOKEN_ALPHA)
+        {
+            code[1] |= STEP_WORD << i;
+            if(n + 1 + token->length > space)
+                return 0;
+            code[n++] = token->length;
+            memcpy(&code[n], &line[token->offset], token->length);
+            n += token->length;
+        }
+        else
+        {
+            uint32_t value = token->value;
+            do
+            {
+                if(n == space)
+                    return 0;
+                code[n++] = (value & 0x7F) | (value > 0x7F ? 0x80 : 0);
+                value >>= 7;
+            } while(value != 0);
+        }
+    }
+    return n;
+}
+
+// Rebuilds a step as tokens, with words copied into line; returns the bytes
+// read, or 0 if the step runs past length
+uint8_t decodeStep(const uint8_t* code, uint16_t length, uint8_t* opcode, char* line,
+                   struct token* tokens, uint8_t* fieldCount)
+{
+    uint8_t args, i, shift;
+    uint16_t n = 2;
+    uint8_t end = 0;
+
+    if(length < 2 || (code[1] & STEP_COUNT) > STEP_ARGS_MAX)
+        return 0;
+    *opcode = code[0];
+    args = code[1] & STEP_COUNT;
+    memset(&tokens[0], 0, sizeof(tokens[0]));
+    tokens[0].kind = TOKEN_ALPHA;
+    for(i = 1; i <= args; i++)
+    {
+        struct token* token = &tokens[i];
+        memset(token, 0, sizeof(*token));
+        if(code[1] & (STEP_WORD << (i - 1)))
+        {
+            if(n >= length || n + 1 + code[n] > length || end + code[n] + 1 > MAX_CHARS)
+                return 0;
+            token->kind = TOKEN_ALPHA;
+            token->offset = end;
+            token->length = code[n++];
+            memcpy(&line[end], &code[n], token->length);
+            n += token->length;
+            end += token->length;
+            line[end++] = ' ';
+        }
+        else
+        {
+            token->kind = TOKEN_NUMBER;
+            for(shift = 0; ; shift += 7)
+            {
+                if(n >= length || shift > 28)
+                    return 0;
+                token->value |= (uint32_t)(code[n] & 0x7F) << shift;
+                if((code[n++] & 0x80) == 0)
+                    break;
+            }
+        }
+    }
+    line[end] = '\0';
+    *fieldCount = args + 1;
+    return n;
+}
+
+// Reads slot into script; the script is filled in for valid and stale slots
+uint8_t readScript(uint8_t slot, struct script* script, uint32_t signature)
+{
+    struct scriptSlot image;
+
+    EEPROMRead((uint32_t*)&image, slotAddress(slot), sizeof(image));
+    if(image.header.magic != SCRIPT_MAGIC)
+        return SCRIPT_EMPTY;
+    if(image.header.length > SCRIPT_CODE_MAX || image.header.crc != scriptCrc(&image))
+        return SCRIPT_CORRUPT;
+    memcpy(script->name, image.header.name, sizeof(script->name));
+    script->name[SCRIPT_NAME_MAX] = '\0';
+    script->length = image.header.length;
+    script->steps = image.header.steps;
+    script->boot = (image.header.flags & FLAG_BOOT) != 0;
+    memcpy(script->code, image.code, image.header.length);
+    return image.header.signature == signature ? SCRIPT_VALID : SCRIPT_STALE;
+}
+
+// Slot holding a valid or stale script called name, or SCRIPT_NONE; the
+// slots are read into scratch
+uint8_t findScript(const char* name, uint32_t signature, struct script* scratch)
+{
+    uint8_t slot, state;
+
+    for(slot = 0; slot < SCRIPT_SLOTS; slot++)
+    {
+        state = readScript(slot, scratch, signature);
+        if((state == SCRIPT_VALID || state == SCRIPT_STALE) && strcmp(scratch->name, name) == 0)
+            return slot;
+    }
+    return SCRIPT_NONE;
+}
+
+// Programs script over the one with the same name, or into a free slot, and
+// reads it back into scratch. script may be scratch itself: the slot image is
+// built before scratch is used.
+bool writeScript(const struct script* script, uint32_t signature, struct script* scratch)
+{
+    struct scriptSlot image;
+    uint8_t slot, i, state;
+    uint16_t words;
+
+    if(!isPromWritable() || script->length > SCRIPT_CODE_MAX)
+        return false;
+    memset(&image, 0, sizeof(image));
+    image.header.magic = SCRIPT_MAGIC;
+    image.header.signature = signature;
+    image.header.length = script->length;
+    image.header.steps = script->steps;
+    image.header.flags = script->boot ? FLAG_BOOT : 0;
+    strcpy(image.header.name, script->name);
+    memcpy(image.code, script->code, script->length);
+    image.header.crc = scriptCrc(&image);
+
+    slot = findScript(image.header.name, signature, scratch);
+    for(i = 0; slot == SCRIPT_NONE && i < SCRIPT_SLOTS; i++)
+    {
+        state = readScript(i, scratch, signature);
+        if(state == SCRIPT_EMPTY || state == SCRIPT_CORRUPT)
+            slot = i;
+    }
+    if(slot == SCRIPT_NONE)
+        return false;
+    words = (sizeof(image.header) + image.header.length + 3) / 4;
+    if(EEPROMProgram((uint32_t*)&image, slotAddress(slot), words * 4) != 0)
+        return false;
+    return readScript(slot, scratch, signature) == SCRIPT_VALID;
+}
+
+bool eraseScript(uint8_t slot)
+{
+    uint32_t blank = 0xFFFFFFFF;
+
+    if(!isPromWritable() || slot >= SCRIPT_SLOTS)
+        return false;
+    return EEPROMProgram(&blank, slotAddress(slot), sizeof(blank)) == 0;
+}
+
+// Marks slot as the boot script and clears the mark on the other valid
+// scripts (stale ones never run); SCRIPT_NONE clears them all. The slots are
+// read into scratch.
+bool setBootScript(uint8_t slot, uint32_t signature, struct script* scratch)
+{
+    uint8_t i;
+    bool ok = true;
+
+    for(i = 0; i < SCRIPT_SLOTS; i++)
+    {
+        uint8_t state = readScript(i, scratch, signature);
+        if(state == SCRIPT_VALID && scratch->boot != (i == slot))
+        {
+            scratch->boot = i == slot;
+            ok = writeScript(scratch, signature, scratch) && ok;
+        }
+    }
+    return ok;
+}
+
+// Slot of the valid script marked to run at boot, or SCRIPT_NONE; the slots
+// are read into scratch
+uint8_t findBootScript(uint32_t signature, struct script* scratch)
+{
+    uint8_t slot;
+
+    for(slot = 0; slot < SCRIPT_SLOTS; slot++)
+        if(readScript(slot, scratch, signature) == SCRIPT_VALID && scratch->boot)
+            return slot;
+    return SCRIPT_NONE;
+}
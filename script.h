@@ -0,0 +1,55 @@
+// Script functions
+// Command sequences stored in EEPROM as pre-tokenized steps
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef SCRIPT_H_
+#define SCRIPT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "token.h"
+
+#define SCRIPT_SLOTS        4
+#define SCRIPT_SLOT_WORDS   48          // 3 EEPROM blocks
+#define SCRIPT_NAME_MAX     11
+#define SCRIPT_CODE_MAX     (SCRIPT_SLOT_WORDS * 4 - 28)    // slot less its header
+#define SCRIPT_NONE         0xFF
+#define SCRIPT_MAGIC        0x53435231  // "SCR1"
+
+// readScript results
+#define SCRIPT_EMPTY        0
+#define SCRIPT_VALID        1
+#define SCRIPT_CORRUPT      2           // CRC wrong
+#define SCRIPT_STALE        3           // recorded against another command table
+
+struct script
+{
+    char name[SCRIPT_NAME_MAX + 1];
+    uint16_t length;                    // bytes of code
+    uint8_t steps;
+    bool boot;                          // run after the boot status lines
+    uint8_t code[SCRIPT_CODE_MAX];
+};
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint8_t encodeStep(uint8_t* code, uint16_t space, uint8_t opcode, const char* line,
+                   const struct token* tokens, uint8_t fieldCount);
+uint8_t decodeStep(const uint8_t* code, uint16_t length, uint8_t* opcode, char* line,
+                   struct token* tokens, uint8_t* fieldCount);
+uint8_t readScript(uint8_t slot, struct script* script, uint32_t signature);
+uint8_t findScript(const char* name, uint32_t signature, struct script* scratch);
+bool writeScript(const struct script* script, uint32_t signature, struct script* scratch);
+bool eraseScript(uint8_t slot);
+bool setBootScript(uint8_t slot, uint32_t signature, struct script* scratch);
+uint8_t findBootScript(uint32_t signature, struct script* scratch);
+
+#endif
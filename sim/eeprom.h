@@ -0,0 +1,23 @@
+// EEPROM driver API (host build)
+// Same subset of the TivaWare driverlib/eeprom.h interface that the firmware
+// uses, implemented by the simulator in sim.c.
+
+#ifndef EEPROM_H_
+#define EEPROM_H_
+
+#include <stdint.h>
+
+#define EEPROM_INIT_OK      0
+#define EEPROM_INIT_ERROR   2
+
+#define EEPROM_RC_WRBUSY    0x00000020
+#define EEPROM_RC_INVPL     0x00000100
+
+uint32_t EEPROMInit(void);
+uint32_t EEPROMSizeGet(void);
+uint32_t EEPROMBlockCountGet(void);
+void EEPROMRead(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count);
+uint32_t EEPROMProgram(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count);
+uint32_t EEPROMMassErase(void);
+
+#endif
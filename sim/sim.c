@@ -0,0 +1,1039 @@
+// Optical front end simulator
+// Host implementation of hal.h, wait.h and the EEPROM driver so the firmware
+// logic can run on Linux without a board.
+
+//-----------------------------------------------------------------------------
+// Simulated Target
+//-----------------------------------------------------------------------------
+
+// Everything runs on a virtual clock counted in 40 MHz system clocks. Busy waits,
+// ADC conversions, UART characters and EEPROM writes advance the clock instead
+// of burning wall time. Interrupts (Timer1A, Timer2A, ADC0 SS0/SS2/SS3, UART0
+// RX/TX, uDMA done) are dispatched when the clock crosses their event time, unless masked
+// or already inside an ISR. Timer3A triggers SS2 conversions in hardware.
+//
+// Model:
+//   LED intensity:  gain * (duty ^ gamma) per channel, scaled by the sample
+//                   reflectance and summed with an ambient/offset term
+//   Photodiode:     first-order response with time constant SIM_TAU_US
+//   ADC:            12-bit, gaussian noise of SIM_NOISE counts rms, 1 us per
+//                   conversion times the hardware averaging factor
+//   UART0:          stdout/stdin, 16-deep FIFOs moving at the baud rate; stdin
+//                   is sent a line at a time like an operator would, once the
+//                   firmware is idle (sleeping in waitForInput())
+//                   and its output has gone quiet (uDMA output does not count)
+//                   and echoes the bytes announced by a "linktest echo" line
+//   uDMA:           a UART0 TX transfer keeps the FIFO full and interrupts when
+//                   the last byte is in the FIFO
+//   EEPROM:         2 KB, word read and programming times, optional image file
+//
+// Environment:
+//   SIM_SAMPLE=r,g,b    sample reflectance 0-255 per channel (255,255,255)
+//   SIM_AMBIENT=n       ambient light plus ADC offset in counts (40)
+//   SIM_AMBIENT_SWING=n ambient varies by +/- n counts (0) ...
+//   SIM_AMBIENT_PERIOD_MS=n  ... sinusoidally with this period (10000)
+//   SIM_NOISE=x         ADC noise in counts rms (1.5)
+//   SIM_TAU_US=n        photodiode time constant in us (400)
+//   SIM_SEED=n          noise generator seed (1)
+//   SIM_EEPROM=path     EEPROM image, loaded at init and saved on every write
+//   SIM_EEPROM_INIT_FAILS=n  EEPROMInit reports an error the first n times (0)
+//   SIM_RUN_MS=n        virtual ms to keep running once stdin has ended and
+//                       the firmware is idle (0)
+//   SIM_RX_BURST=1      send stdin back-to-back without waiting for the firmware
+//   SIM_LINE_DELAY_MS=n the host waits at least n virtual ms after a line before
+//                       typing the next one (0)
+//   SIM_HOST_MAX_BAUD=n the host cannot follow faster rates: characters either
+//                       way are garbled (no limit)
+//   SIM_HOST_ECHO_US=n  host turnaround when it echoes a "linktest echo" (2000)
+
+#ifdef HOST_SIM
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "hal.h"
+#include "uart0.h"
+#include "wait.h"
+#include "eeprom.h"
+
+#define CLOCKS_PER_US       (SYSTEM_CLOCK / 1000000)
+#define ADC_CONVERSION_US   1               // 1 Msps
+#define UART_FIFO_DEPTH     16
+#define EEPROM_WORDS        512             // 2 KB
+#define EEPROM_WRITE_US     110             // approximate word program time
+#define EEPROM_READ_CLOCKS  10              // word read through EERDWR, with driver overhead
+#define EEPROM_INIT_US      20              // wait for EEDONE after reset
+#define EEPROM_ERASE_US     2000
+#define PB1_PRESS_MS        500             // button is pressed this long after polling starts
+#define PB1_HOLD_MS         100
+#define UART_TX_TRIGGER     8               // TX interrupt at FIFO half full
+#define UART_POLL_CLOCKS    8               // a polled status read that finds nothing
+#define LOOPBACK_DEPTH      1024            // loopback, or a host echo at 1 Mbaud and 10 ms
+
+#define EVENT_NONE          0
+#define EVENT_TIMER1        1
+#define EVENT_UART0_TX      2
+#define EVENT_UART0_RX      3
+#define EVENT_TIMER2        4
+#define EVENT_ADC0_SS3      5
+#define EVENT_ADC0_SS0      6
+#define EVENT_TIMER3        7
+#define EVENT_ADC0_SS2      8
+#define EVENT_WAKE          9
+#define EVENT_UART0_DMA     10
+
+extern void periodIsr(void);
+extern void uart0Isr(void);
+extern void settleTimerIsr(void);
+extern void adc0Ss3Isr(void);
+extern void adc0Ss0Isr(void);
+extern void adc0Ss2Isr(void);
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static uint64_t simClock = 0;               // virtual system clocks since reset
+static bool inIsr = false;                  // interrupts do not nest
+static uint32_t irqMasked = 0;              // PRIMASK
+static bool waitingForInput = false;        // in waitForInput()
+
+static bool timer1Enabled = false;
+static uint32_t timer1Load = 0;
+static uint64_t timer1Deadline = 0;
+static bool timer2Enabled = false;
+static uint64_t timer2Deadline = 0;
+
+static bool adcBusy = false;
+static uint64_t adcDoneAt = 0;
+static uint16_t adcResult = 0;
+static bool adcRetrigger = false;           // started again while busy, runs next
+static uint8_t adcAverageLog2 = 0;
+static bool ss0Busy = false;
+static uint64_t ss0DoneAt = 0;
+static uint8_t ss0Count = 0;
+static uint16_t ss0Results[8];
+static uint8_t ss0ResultCount = 0;          // conversions in the FIFO
+static uint8_t ss0Retrigger = 0;            // count of a burst started while busy
+static bool timer3Enabled = false;
+static uint64_t timer3Load = 0;
+static uint64_t timer3Deadline = 0;
+static bool ss2Busy = false;
+static uint64_t ss2DoneAt = 0;
+static uint16_t ss2Result = 0;
+
+static uint32_t uartCharClocks;             // 10 bits per 8N1 character
+static uint64_t uartTxDoneAt = 0;           // time the last queued character leaves
+static bool uartTxIntEnabled = false;
+static bool dmaBusy = false;
+static uint64_t dmaDoneAt = 0;              // last byte of the transfer goes into the FIFO
+static char rxFifo[UART_FIFO_DEPTH];
+static uint8_t rxFifoCount = 0;
+static uint8_t rxFifoRead = 0;
+static char hostLine[256];                  // line the simulated host is sending
+static uint16_t hostLinePos = 0;
+static bool hostSending = false;
+static bool hostEof = false;
+static bool hostBurst = false;
+static uint64_t hostNextAt = 0;             // time the next character finishes arriving
+static uint64_t hostLineDelay = 0;
+static uint64_t rxOverruns = 0;
+static uint32_t rxErrors = 0;               // overruns and garbled characters
+static uint32_t uartDivisor = 21 * 64 + 45; // IBRD:FBRD, 115200 baud
+static uint32_t hostMaxBaud = 0;
+static bool loopback = false;
+static char loopChar[LOOPBACK_DEPTH];       // characters on their way from TX to RX
+static uint64_t loopAt[LOOPBACK_DEPTH];
+static uint16_t loopRead = 0;
+static uint16_t loopCount = 0;
+static char hostOutLine[MAX_CHARS + 1];     // output line the host is reading
+static uint8_t hostOutCount = 0;
+static uint32_t hostEchoLeft = 0;           // bytes the host sends back
+static uint64_t hostEchoClocks = 2000 * CLOCKS_PER_US;
+static bool wakeEnabled = false;
+static uint64_t wakeLoad = 0;
+static uint64_t wakeDeadline = 0;
+
+static const double ledGain[3] = {3600, 3100, 2700}; // counts at full duty, white sample
+static const double ledGamma = 1.15;
+static double reflectance[3] = {1, 1, 1};
+static double ambient = 40;
+static double ambientSwing = 0;
+static double ambientPeriod = 10000.0 * 1000 * CLOCKS_PER_US;
+static double noise = 1.5;
+static double tauClocks;
+static uint16_t pwm[3] = {0, 0, 0};
+static double sensor = 0;                   // photodiode output in counts
+static uint64_t sensorAt = 0;
+static uint64_t rngState = 1;
+
+static uint32_t eeprom[EEPROM_WORDS];
+static uint32_t eepromInitFails = 0;
+static const char* eepromPath = NULL;
+
+static bool greenLed = false;
+static uint64_t pb1PressAt = 0;
+static bool pb1Armed = false;
+
+static uint64_t runAfterEof = 0;
+static uint64_t exitAt = UINT64_MAX;        // stdin ended, stop once idle after this
+static struct timespec wallStart;
+static uint64_t adcConversions = 0;
+static uint64_t eepromWordWrites = 0;
+
+//-----------------------------------------------------------------------------
+// Virtual clock
+//-----------------------------------------------------------------------------
+
+// Finds the earliest interrupt that is enabled
+static uint8_t nextEvent(uint64_t* at)
+{
+    uint8_t event = EVENT_NONE;
+    uint64_t t;
+
+    *at = UINT64_MAX;
+    if (timer1Enabled && timer1Deadline < *at)
+    {
+        *at = timer1Deadline;
+        event = EVENT_TIMER1;
+    }
+    if (timer2Enabled && timer2Deadline < *at)
+    {
+        *at = timer2Deadline;
+        event = EVENT_TIMER2;
+    }
+    if (adcBusy && adcDoneAt < *at)
+    {
+        *at = adcDoneAt;
+        event = EVENT_ADC0_SS3;
+    }
+    if (ss0Busy && ss0DoneAt < *at)
+    {
+        *at = ss0DoneAt;
+        event = EVENT_ADC0_SS0;
+    }
+    if (timer3Enabled && timer3Deadline < *at)
+    {
+        *at = timer3Deadline;
+        event = EVENT_TIMER3;
+    }
+    if (ss2Busy && ss2DoneAt < *at)
+    {
+        *at = ss2DoneAt;
+        event = EVENT_ADC0_SS2;
+    }
+    if (wakeEnabled && wakeDeadline < *at)
+    {
+        *at = wakeDeadline;
+        event = EVENT_WAKE;
+    }
+    if (dmaBusy && dmaDoneAt < *at)
+    {
+        *at = dmaDoneAt;
+        event = EVENT_UART0_DMA;
+    }
+    if (hostSending && hostNextAt < *at)
+    {
+        *at = hostNextAt;
+        event = EVENT_UART0_RX;
+    }
+    if (uartTxIntEnabled)
+    {
+        t = uartTxDoneAt > simClock + (uint64_t)UART_TX_TRIGGER * uartCharClocks
+            ? uartTxDoneAt - (uint64_t)UART_TX_TRIGGER * uartCharClocks : simClock;
+        if (t < *at)
+        {
+            *at = t;
+            event = EVENT_UART0_TX;
+        }
+    }
+    return event;
+}
+
+static bool hostSendLine();
+static uint16_t convert();
+static uint16_t convertAt(uint64_t t);
+static void updateSensor();
+static uint64_t adcClocks();
+
+static bool isHostGarbled()
+{
+    return hostMaxBaud != 0 && getUart0Baud() > hostMaxBaud;
+}
+
+// A character finished arriving from the host
+static void receiveChar()
+{
+    if (rxFifoCount == UART_FIFO_DEPTH)
+    {
+        rxOverruns++;
+        rxErrors++;
+    }
+    else if (isHostGarbled())
+        rxErrors++;                         // framing error, nothing usable
+    else
+        rxFifo[(rxFifoRead + rxFifoCount++) % UART_FIFO_DEPTH] = hostLine[hostLinePos];
+    hostLinePos++;
+    hostNextAt += uartCharClocks;
+    if (hostLine[hostLinePos] == '\0')
+    {
+        hostSending = false;
+        if (hostBurst)
+            hostSendLine();
+    }
+}
+
+static void dispatch(uint8_t event)
+{
+    uint8_t i;
+
+    inIsr = true;
+    switch (event)
+    {
+    case EVENT_TIMER1:
+        timer1Deadline += timer1Load;       // hardware reloads at expiry
+        periodIsr();
+        if (timer1Deadline < simClock)      // overran the period, one interrupt stays pending
+            timer1Deadline = simClock;
+        break;
+    case EVENT_UART0_TX:
+        uart0Isr();
+        break;
+    case EVENT_UART0_RX:
+        receiveChar();
+        uart0Isr();
+        break;
+    case EVENT_UART0_DMA:                   // completion comes in on the UART0 vector
+        dmaBusy = false;
+        uart0Isr();
+        break;
+    case EVENT_TIMER2:
+        timer2Enabled = false;              // one-shot
+        settleTimerIsr();
+        break;
+    case EVENT_ADC0_SS3:
+        adcBusy = false;
+        adcResult = convert();
+        if (adcRetrigger)
+        {
+            adcRetrigger = false;
+            startAdc0Ss3();
+        }
+        adc0Ss3Isr();
+        break;
+    case EVENT_ADC0_SS0:
+        ss0Busy = false;
+        for (i = 0; i < ss0Count; i++)      // conversions were spread over the burst
+            ss0Results[i] = convertAt(ss0DoneAt - (uint64_t)(ss0Count - 1 - i) * adcClocks());
+        ss0ResultCount = ss0Count;
+        if (ss0Retrigger)
+        {
+            i = ss0Retrigger;
+            ss0Retrigger = 0;
+            startAdc0Ss0(i);
+        }
+        adc0Ss0Isr();
+        break;
+    case EVENT_TIMER3:                      // no interrupt, the timeout triggers SS2
+        timer3Deadline += timer3Load;
+        ss2Busy = true;
+        ss2DoneAt = simClock + adcClocks();
+        break;
+    case EVENT_ADC0_SS2:
+        ss2Busy = false;
+        ss2Result = convert();
+        adc0Ss2Isr();
+        break;
+    case EVENT_WAKE:                        // nothing to service, WFI returns
+        wakeDeadline += wakeLoad;
+        break;
+    }
+    inIsr = false;
+}
+
+// Advances the virtual clock, servicing interrupts whose time comes up on the way
+static void simAdvance(uint64_t clocks)
+{
+    uint64_t target = simClock + clocks;
+    uint64_t at;
+    uint8_t event;
+
+    while (!inIsr && !irqMasked && (event = nextEvent(&at)) != EVENT_NONE && at <= target)
+    {
+        if (at > simClock)
+            simClock = at;
+        dispatch(event);
+    }
+    if (simClock < target)
+        simClock = target;
+}
+
+static double elapsedWall()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - wallStart.tv_sec) + (now.tv_nsec - wallStart.tv_nsec) / 1e9;
+}
+
+static void simExit()
+{
+    double wall;
+    double virt;
+
+    fflush(stdout);
+    wall = elapsedWall();
+    virt = (double)simClock / SYSTEM_CLOCK;
+    fprintf(stderr, "sim: %.3f s virtual in %.3f s wall, %llu adc conversions (%.0f/s wall), %llu eeprom word writes\n",
+            virt, wall, (unsigned long long)adcConversions, wall > 0 ? adcConversions / wall : 0.0,
+            (unsigned long long)eepromWordWrites);
+    if (rxOverruns)
+        fprintf(stderr, "sim: %llu uart rx overruns\n", (unsigned long long)rxOverruns);
+    exit(0);
+}
+
+//-----------------------------------------------------------------------------
+// Optical front end
+//-----------------------------------------------------------------------------
+
+static double simRandom()
+{
+    // xorshift64*, mapped to (0, 1]
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return ((rngState * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0) + 1e-18;
+}
+
+static double simGaussian()
+{
+    return sqrt(-2 * log(simRandom())) * cos(2 * M_PI * simRandom());
+}
+
+static double sensorTarget()
+{
+    double light = ambient + ambientSwing * sin(2 * M_PI * (double)simClock / ambientPeriod);
+    uint8_t i;
+    for (i = 0; i < 3; i++)
+    {
+        double duty = pwm[i] > 1024 ? 1.0 : pwm[i] / 1024.0;
+        light += reflectance[i] * ledGain[i] * pow(duty, ledGamma);
+    }
+    return light;
+}
+
+static void updateSensor()
+{
+    double target = sensorTarget();
+    sensor = target + (sensor - target) * exp(-(double)(simClock - sensorAt) / tauClocks);
+    sensorAt = simClock;
+}
+
+//-----------------------------------------------------------------------------
+// Initialize Hardware
+//-----------------------------------------------------------------------------
+
+static void loadEeprom()
+{
+    FILE* f;
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    if (eepromPath == NULL)
+        return;
+    f = fopen(eepromPath, "rb");
+    if (f == NULL)
+        return;
+    if (fread(eeprom, 1, sizeof(eeprom), f) != sizeof(eeprom))
+        memset(eeprom, 0xFF, sizeof(eeprom));
+    fclose(f);
+}
+
+static void saveEeprom()
+{
+    FILE* f;
+    if (eepromPath == NULL)
+        return;
+    f = fopen(eepromPath, "wb");
+    if (f == NULL)
+        return;
+    fwrite(eeprom, 1, sizeof(eeprom), f);
+    fclose(f);
+}
+
+void initHw()
+{
+    const char* env;
+    unsigned r, g, b;
+
+    clock_gettime(CLOCK_MONOTONIC, &wallStart);
+
+    if ((env = getenv("SIM_SAMPLE")) != NULL && sscanf(env, "%u,%u,%u", &r, &g, &b) == 3)
+    {
+        reflectance[0] = r / 255.0;
+        reflectance[1] = g / 255.0;
+        reflectance[2] = b / 255.0;
+    }
+    if ((env = getenv("SIM_AMBIENT")) != NULL)
+        ambient = atof(env);
+    if ((env = getenv("SIM_AMBIENT_SWING")) != NULL)
+        ambientSwing = atof(env);
+    if ((env = getenv("SIM_AMBIENT_PERIOD_MS")) != NULL && atof(env) > 0)
+        ambientPeriod = atof(env) * 1000 * CLOCKS_PER_US;
+    if ((env = getenv("SIM_NOISE")) != NULL)
+        noise = atof(env);
+    tauClocks = 400.0 * CLOCKS_PER_US;
+    if ((env = getenv("SIM_TAU_US")) != NULL && atof(env) > 0)
+        tauClocks = atof(env) * CLOCKS_PER_US;
+    if ((env = getenv("SIM_SEED")) != NULL && strtoull(env, NULL, 0) != 0)
+        rngState = strtoull(env, NULL, 0);
+    hostBurst = getenv("SIM_RX_BURST") != NULL;
+    if ((env = getenv("SIM_LINE_DELAY_MS")) != NULL)
+        hostLineDelay = strtoull(env, NULL, 0) * 1000 * CLOCKS_PER_US;
+    if ((env = getenv("SIM_RUN_MS")) != NULL)
+        runAfterEof = strtoull(env, NULL, 0) * 1000 * CLOCKS_PER_US;
+    eepromPath = getenv("SIM_EEPROM");
+    if ((env = getenv("SIM_EEPROM_INIT_FAILS")) != NULL)
+        eepromInitFails = strtoul(env, NULL, 0);
+    loadEeprom();
+
+    if ((env = getenv("SIM_HOST_MAX_BAUD")) != NULL)
+        hostMaxBaud = strtoul(env, NULL, 0);
+    if ((env = getenv("SIM_HOST_ECHO_US")) != NULL)
+        hostEchoClocks = strtoull(env, NULL, 0) * CLOCKS_PER_US;
+
+    // 115200 baud, 8N1: r = 40 MHz / (16 x 115.2 kHz) = 21 + 45/64
+    uartCharClocks = 10 * uartDivisor / 4;
+
+    sensor = ambient;
+    sensorAt = simClock;
+}
+
+//-----------------------------------------------------------------------------
+// Interrupt masking
+//-----------------------------------------------------------------------------
+
+uint32_t disableInterrupts()
+{
+    uint32_t state = irqMasked;
+    irqMasked = 1;
+    return state;
+}
+
+void restoreInterrupts(uint32_t state)
+{
+    irqMasked = state;
+    if (!irqMasked)
+        simAdvance(0);                      // take anything that became pending
+}
+
+bool inInterrupt()
+{
+    return inIsr;
+}
+
+uint32_t readCycleCounter()
+{
+    return (uint32_t)simClock;
+}
+
+// Host monotonic time scaled to 40 MHz clocks; only ratios between host
+// measurements mean anything
+uint32_t readCpuCycles()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * SYSTEM_CLOCK + (uint64_t)now.tv_nsec / (1000000000 / SYSTEM_CLOCK));
+}
+
+// Sleeps until the next interrupt. This is also where the simulated host
+// decides to type the next line: the firmware sleeps in waitForInput() (with
+// interrupts masked around it) and its output is done.
+void waitForInterrupt()
+{
+    uint64_t at;
+    bool idle = waitingForInput && irqMasked && !inIsr;
+    bool quiet = !uartTxIntEnabled && (uartTxDoneAt <= simClock || dmaBusy);
+    bool ready = hostNextAt + hostLineDelay <= simClock;
+
+    if (idle && quiet && !hostSending && (ready || hostEof))
+    {
+        if (!hostEof)
+            hostSendLine();
+        if (hostEof && exitAt == UINT64_MAX)
+            exitAt = simClock + runAfterEof;
+        if (hostEof && simClock >= exitAt)
+            simExit();
+    }
+    if (nextEvent(&at) == EVENT_NONE)
+        at = simClock + CLOCKS_PER_US;
+    if (!hostSending && uartTxDoneAt > simClock && uartTxDoneAt < at)
+        at = uartTxDoneAt;                  // wake when the output goes quiet
+    if (!hostSending && !ready && hostNextAt + hostLineDelay < at)
+        at = hostNextAt + hostLineDelay;    // or when the host is ready to type
+    if (exitAt > simClock && exitAt < at)
+        at = exitAt;
+    simAdvance(at > simClock ? at - simClock : 0);
+}
+
+void waitForInput()
+{
+    waitingForInput = true;
+    waitForInterrupt();
+    waitingForInput = false;
+}
+
+//-----------------------------------------------------------------------------
+// RGB backlight and light sensor
+//-----------------------------------------------------------------------------
+
+void setRgbColor(uint16_t red, uint16_t green, uint16_t blue)
+{
+    updateSensor();
+    pwm[0] = red;
+    pwm[1] = green;
+    pwm[2] = blue;
+}
+
+static uint64_t adcClocks()
+{
+    return ((uint64_t)ADC_CONVERSION_US * CLOCKS_PER_US) << adcAverageLog2;
+}
+
+// Samples the photodiode at time t (no later than the next PWM change), with
+// the hardware averager summing 2^n noisy samples and truncating
+static uint16_t convertAt(uint64_t t)
+{
+    double target = sensorTarget();
+    double level = target + (sensor - target) * exp(-((double)t - (double)sensorAt) / tauClocks);
+    int32_t sum = 0;
+    double value;
+    uint8_t i;
+
+    for (i = 0; i < (1 << adcAverageLog2); i++)
+    {
+        value = floor(level + noise * simGaussian() + 0.5);
+        if (value < 0)
+            value = 0;
+        if (value > 4095)
+            value = 4095;
+        sum += value;
+    }
+    adcConversions++;
+    return sum >> adcAverageLog2;
+}
+
+static uint16_t convert()
+{
+    updateSensor();
+    return convertAt(simClock);
+}
+
+uint16_t readAdc0Ss3()
+{
+    simAdvance(adcClocks());
+    return convert();
+}
+
+void startAdc0Ss3()
+{
+    if (adcBusy)                            // the trigger is latched, like the hardware
+    {
+        adcRetrigger = true;
+        return;
+    }
+    adcBusy = true;
+    adcDoneAt = simClock + adcClocks();
+}
+
+uint16_t readAdc0Ss3Result()
+{
+    return adcResult;
+}
+
+void startAdc0Ss0(uint8_t count)
+{
+    if (ss0Busy)
+    {
+        ss0Retrigger = count;
+        return;
+    }
+    ss0Count = count > 8 ? 8 : count;
+    ss0Busy = true;
+    ss0DoneAt = simClock + ss0Count * adcClocks();
+}
+
+uint8_t readAdc0Ss0Results(uint16_t* results)
+{
+    uint8_t i;
+    for (i = 0; i < ss0ResultCount; i++)
+        results[i] = ss0Results[i];
+    return ss0ResultCount;
+}
+
+void startSweepTimer(uint32_t us)
+{
+    timer3Load = (uint64_t)us * CLOCKS_PER_US;
+    timer3Deadline = simClock + timer3Load;
+    timer3Enabled = true;
+}
+
+void stopSweepTimer()
+{
+    timer3Enabled = false;
+}
+
+uint16_t readAdc0Ss2Result()
+{
+    return ss2Result;
+}
+
+void setAdcAveraging(uint8_t log2n)
+{
+    adcAverageLog2 = log2n > 6 ? 6 : log2n;
+}
+
+//-----------------------------------------------------------------------------
+// Timer2 one-shot settle timer
+//-----------------------------------------------------------------------------
+
+void startSettleTimer(uint32_t us)
+{
+    timer2Deadline = simClock + (uint64_t)us * CLOCKS_PER_US;
+    timer2Enabled = true;
+}
+
+void stopSettleTimer()
+{
+    timer2Enabled = false;
+}
+
+void clearSettleTimerInt()
+{
+}
+
+//-----------------------------------------------------------------------------
+// Wake timer
+//-----------------------------------------------------------------------------
+
+void startWakeTimer(uint32_t us)
+{
+    wakeLoad = (uint64_t)us * CLOCKS_PER_US;
+    wakeDeadline = simClock + wakeLoad;
+    wakeEnabled = true;
+}
+
+void stopWakeTimer()
+{
+    wakeEnabled = false;
+}
+
+//-----------------------------------------------------------------------------
+// UART0
+//-----------------------------------------------------------------------------
+
+// Same divisor arithmetic as the hardware; a character is 10 bits of 16 clocks
+// of the divided system clock
+bool setUart0Baud(uint32_t baud)
+{
+    uint32_t divisor;
+
+    if (baud == 0 || baud > SYSTEM_CLOCK / 16)
+        return false;
+    divisor = (SYSTEM_CLOCK * 4 + baud / 2) / baud;
+    if (divisor >> 6 == 0 || divisor >> 6 > 0xFFFF)
+        return false;
+    uartDivisor = divisor;
+    uartCharClocks = 10 * uartDivisor / 4;
+    return true;
+}
+
+uint32_t getUart0Baud()
+{
+    return (SYSTEM_CLOCK * 4 + uartDivisor / 2) / uartDivisor;
+}
+
+bool isUart0Busy()
+{
+    if (uartTxDoneAt > simClock)
+        simAdvance(UART_POLL_CLOCKS);       // polling takes time too
+    return uartTxDoneAt > simClock;
+}
+
+void setUart0Loopback(bool on)
+{
+    loopback = on;
+    loopCount = 0;
+}
+
+uint32_t getUart0RxErrors()
+{
+    return rxErrors;
+}
+
+// Moves looped back or echoed characters that have finished arriving into
+// the RX FIFO
+static void receiveLoopback()
+{
+    while (loopCount > 0 && loopAt[loopRead] <= simClock)
+    {
+        if (rxFifoCount == UART_FIFO_DEPTH)
+        {
+            rxOverruns++;
+            rxErrors++;
+        }
+        else if (!loopback && isHostGarbled())
+            rxErrors++;                     // the host echoed what it could not read
+        else
+            rxFifo[(rxFifoRead + rxFifoCount++) % UART_FIFO_DEPTH] = loopChar[loopRead];
+        loopRead = (loopRead + 1) % LOOPBACK_DEPTH;
+        loopCount--;
+    }
+}
+
+static void queueLoopback(char c, uint64_t at)
+{
+    if (loopCount < LOOPBACK_DEPTH)
+    {
+        loopChar[(loopRead + loopCount) % LOOPBACK_DEPTH] = c;
+        loopAt[(loopRead + loopCount++) % LOOPBACK_DEPTH] = at;
+    }
+}
+
+// The host reads the output a line at a time; after a LINK_ECHO_TAG line it
+// sends the next count bytes back, each one turnaround time after it arrived
+static void watchHostOutput(char c)
+{
+    if (c == '\n' || hostOutCount == MAX_CHARS)
+    {
+        hostOutLine[hostOutCount] = '\0';
+        hostOutCount = 0;
+        if (strncmp(hostOutLine, LINK_ECHO_TAG, strlen(LINK_ECHO_TAG)) == 0)
+            hostEchoLeft = strtoul(hostOutLine + strlen(LINK_ECHO_TAG), NULL, 10);
+    }
+    else
+        hostOutLine[hostOutCount++] = c;
+}
+
+bool isUart0TxFull()
+{
+    // 16 in the FIFO plus one in the shift register
+    return uartTxDoneAt > simClock + (uint64_t)UART_FIFO_DEPTH * uartCharClocks;
+}
+
+void writeUart0Tx(char c)
+{
+    if (isUart0TxFull())                    // overrun, the hardware drops it
+        return;
+    if (uartTxDoneAt < simClock)
+        uartTxDoneAt = simClock;
+    uartTxDoneAt += uartCharClocks;
+    if (loopback)
+        queueLoopback(c, uartTxDoneAt);
+    else if (hostEchoLeft > 0)
+    {
+        hostEchoLeft--;
+        queueLoopback(c, uartTxDoneAt + hostEchoClocks + uartCharClocks);
+    }
+    else
+    {
+        putchar(isHostGarbled() ? '?' : c);
+        watchHostOutput(c);
+    }
+}
+
+void startUart0TxDma(const uint8_t* data, uint16_t length)
+{
+    uint16_t i;
+
+    if (uartTxDoneAt < simClock)
+        uartTxDoneAt = simClock;
+    uartTxDoneAt += (uint64_t)length * uartCharClocks;
+    for (i = 0; i < length; i++)
+        putchar(isHostGarbled() ? '?' : data[i]);
+    dmaBusy = true;
+    dmaDoneAt = uartTxDoneAt > simClock + (uint64_t)UART_FIFO_DEPTH * uartCharClocks
+              ? uartTxDoneAt - (uint64_t)UART_FIFO_DEPTH * uartCharClocks : simClock;
+}
+
+bool isUart0TxDmaBusy()
+{
+    return dmaBusy;
+}
+
+void enableUart0TxInt()
+{
+    uartTxIntEnabled = true;
+}
+
+void disableUart0TxInt()
+{
+    uartTxIntEnabled = false;
+}
+
+void clearUart0Int()
+{
+}
+
+bool isUart0RxEmpty()
+{
+    receiveLoopback();
+    if (rxFifoCount == 0)
+    {
+        simAdvance(UART_POLL_CLOCKS);       // polling takes time too
+        receiveLoopback();
+    }
+    return rxFifoCount == 0;
+}
+
+char readUart0Rx()
+{
+    char c = rxFifo[rxFifoRead];
+    if (rxFifoCount == 0)
+        return 0;
+    rxFifoRead = (rxFifoRead + 1) % UART_FIFO_DEPTH;
+    rxFifoCount--;
+    return c;
+}
+
+// Starts sending the next stdin line, ended with CR LF like a terminal would
+static bool hostSendLine()
+{
+    uint16_t n;
+
+    fflush(stdout);
+    if (hostEof || fgets(hostLine, sizeof(hostLine) - 2, stdin) == NULL)
+    {
+        hostEof = true;
+        return false;
+    }
+    n = strcspn(hostLine, "\r\n");
+    strcpy(hostLine + n, "\r\n");
+    hostLinePos = 0;
+    hostSending = true;
+    hostNextAt = (hostNextAt > simClock ? hostNextAt : simClock) + uartCharClocks;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// On-board LED and push button
+//-----------------------------------------------------------------------------
+
+void setGreenLed(bool on)
+{
+    greenLed = on;
+}
+
+// The simulated operator presses SW1 PB1_PRESS_MS after the firmware starts
+// polling for it and holds it for PB1_HOLD_MS
+bool isPb1Pressed()
+{
+    simAdvance(CLOCKS_PER_US);
+    if (!pb1Armed)
+    {
+        pb1Armed = true;
+        pb1PressAt = simClock + (uint64_t)PB1_PRESS_MS * 1000 * CLOCKS_PER_US;
+    }
+    if (simClock < pb1PressAt)
+        return false;
+    if (simClock >= pb1PressAt + (uint64_t)PB1_HOLD_MS * 1000 * CLOCKS_PER_US)
+    {
+        pb1Armed = false;
+        return false;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Timer1 periodic interrupt
+//-----------------------------------------------------------------------------
+
+void enablePeriodTimer(uint32_t load)
+{
+    timer1Load = load ? load : 1;
+    timer1Deadline = simClock + timer1Load;
+    timer1Enabled = true;
+}
+
+void disablePeriodTimer()
+{
+    timer1Enabled = false;
+}
+
+void clearPeriodTimerInt()
+{
+}
+
+//-----------------------------------------------------------------------------
+// Wait functions
+//-----------------------------------------------------------------------------
+
+void waitMicrosecond(uint32_t us)
+{
+    simAdvance((uint64_t)us * CLOCKS_PER_US);
+}
+
+//-----------------------------------------------------------------------------
+// EEPROM driver
+//-----------------------------------------------------------------------------
+
+uint32_t EEPROMInit(void)
+{
+    simAdvance((uint64_t)EEPROM_INIT_US * CLOCKS_PER_US);
+    if (eepromInitFails > 0)
+    {
+        eepromInitFails--;
+        return EEPROM_INIT_ERROR;
+    }
+    return EEPROM_INIT_OK;
+}
+
+uint32_t EEPROMSizeGet(void)
+{
+    return sizeof(eeprom);
+}
+
+uint32_t EEPROMBlockCountGet(void)
+{
+    return EEPROM_WORDS / 16;
+}
+
+void EEPROMRead(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count)
+{
+    if ((ui32Address & 3) || (ui32Count & 3) || ui32Address + ui32Count > sizeof(eeprom))
+        return;
+    memcpy(pui32Data, (uint8_t*)eeprom + ui32Address, ui32Count);
+    simAdvance((uint64_t)EEPROM_READ_CLOCKS * (ui32Count / 4));
+}
+
+uint32_t EEPROMProgram(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count)
+{
+    uint32_t i;
+
+    if ((ui32Address & 3) || (ui32Count & 3) || ui32Address + ui32Count > sizeof(eeprom))
+        return EEPROM_RC_INVPL;
+    for (i = 0; i < ui32Count / 4; i++)
+    {
+        eeprom[ui32Address / 4 + i] = pui32Data[i];
+        simAdvance((uint64_t)EEPROM_WRITE_US * CLOCKS_PER_US);
+        eepromWordWrites++;
+    }
+    saveEeprom();
+    return 0;
+}
+
+uint32_t EEPROMMassErase(void)
+{
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    simAdvance((uint64_t)EEPROM_ERASE_US * CLOCKS_PER_US);
+    saveEeprom();
+    return 0;
+}
+
+#endif
@@ -0,0 +1,295 @@
+// Statistical process control functions
+// Rolling per-channel statistics and X-bar/R control-limit alarms
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Each sample updates a Welford running mean and sum of squared deviations
+// per channel, in fixed point (mean Q8 in 32 bits, M2 Q16 in 64 bits), so
+// nothing is stored per sample and no float is used:
+//
+//   n += 1;  d = x - mean;  mean += d / n;  M2 += d x (x - mean)
+//
+// Every window samples the statistics are latched and start over.
+// Independently, consecutive samples form subgroups of 2-10. The first
+// SPC_BASELINE subgroups set the Shewhart limits from the grand mean and the
+// mean range:
+//
+//   X-bar: center +/- A2 x R-bar      R: D3 x R-bar to D4 x R-bar
+//
+// and every later subgroup is checked against them. A channel's alarm is
+// reported when it goes out of control, not again while it stays out.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "spc.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+// Shewhart constants for subgroups of 2-10, in thousandths
+static const uint16_t factorA2[SPC_SUBGROUP_MAX + 1] = {0, 0, 1880, 1023, 729, 577, 483, 419, 373, 337, 308};
+static const uint16_t factorD3[SPC_SUBGROUP_MAX + 1] = {0, 0, 0, 0, 0, 0, 0, 76, 136, 184, 223};
+static const uint16_t factorD4[SPC_SUBGROUP_MAX + 1] = {0, 0, 3267, 2574, 2282, 2114, 2004, 1924, 1864, 1816, 1777};
+
+struct welford
+{
+    uint16_t count;
+    int32_t mean;                   // Q8
+    int64_t m2;                     // Q16
+    uint16_t min;
+    uint16_t max;
+};
+
+static uint16_t window = SPC_WINDOW;
+static uint8_t subgroup = SPC_SUBGROUP;
+static struct welford current[3];
+static struct welford latched[3];   // last complete window
+static bool haveLatched = false;
+
+static uint8_t groupCount = 0;      // samples in the subgroup being collected
+static uint32_t groupSum[3];
+static uint16_t groupMin[3];
+static uint16_t groupMax[3];
+static uint16_t baselineCount = 0;
+static uint64_t xbarSum[3];         // Q8, over the baseline subgroups
+static uint64_t rangeSum[3];
+static struct spcLimits limits[3];
+static bool haveLimits = false;
+static uint16_t alarmState = 0;     // channels out of control after the last subgroup
+
+static uint32_t samples = 0;
+static uint32_t subgroups = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static uint32_t isqrt64(uint64_t x)
+{
+    uint64_t root = 0, bit = (uint64_t)1 << 62;
+
+    while (bit > x)
+        bit >>= 2;
+    while (bit != 0)
+    {
+        if (x >= root + bit)
+        {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+            root >>= 1;
+        bit >>= 2;
+    }
+    return root;
+}
+
+static void resetWelford(struct welford* w)
+{
+    w->count = 0;
+    w->mean = 0;
+    w->m2 = 0;
+    w->min = 0xFFFF;
+    w->max = 0;
+}
+
+static void addWelford(struct welford* w, uint16_t x)
+{
+    int32_t value = (int32_t)x << SPC_FRAC;
+    int32_t delta = value - w->mean;
+
+    w->count++;
+    w->mean += delta / w->count;
+    w->m2 += (int64_t)delta * (value - w->mean);
+    if (x < w->min)
+        w->min = x;
+    if (x > w->max)
+        w->max = x;
+}
+
+// Starts over with new settings; the control limits are learned again
+void startSpc(uint16_t samplesPerWindow, uint8_t samplesPerGroup)
+{
+    uint8_t i;
+
+    window = samplesPerWindow < 2 ? 2 : samplesPerWindow;
+    if (samplesPerGroup < SPC_SUBGROUP_MIN)
+        samplesPerGroup = SPC_SUBGROUP_MIN;
+    if (samplesPerGroup > SPC_SUBGROUP_MAX)
+        samplesPerGroup = SPC_SUBGROUP_MAX;
+    subgroup = samplesPerGroup;
+    for (i = 0; i < 3; i++)
+    {
+        resetWelford(&current[i]);
+        xbarSum[i] = rangeSum[i] = 0;
+        limits[i].alarms = 0;
+    }
+    haveLatched = false;
+    groupCount = 0;
+    baselineCount = 0;
+    haveLimits = false;
+    alarmState = 0;
+    samples = subgroups = 0;
+}
+
+uint16_t getSpcWindow()
+{
+    return window;
+}
+
+uint8_t getSpcSubgroup()
+{
+    return subgroup;
+}
+
+static void setLimits()
+{
+    struct spcLimits* l;
+    uint32_t spread;
+    uint8_t i;
+
+    for (i = 0; i < 3; i++)
+    {
+        l = &limits[i];
+        l->xbarCenter = xbarSum[i] / SPC_BASELINE;
+        l->rangeCenter = rangeSum[i] / SPC_BASELINE;
+        spread = (uint64_t)l->rangeCenter * factorA2[subgroup] / 1000;
+        l->xbarUpper = l->xbarCenter + spread;
+        l->xbarLower = l->xbarCenter > spread ? l->xbarCenter - spread : 0;
+        l->rangeUpper = (uint64_t)l->rangeCenter * factorD4[subgroup] / 1000;
+        l->rangeLower = (uint64_t)l->rangeCenter * factorD3[subgroup] / 1000;
+    }
+    haveLimits = true;
+}
+
+// Closes a subgroup; returns the alarm bits of the channels that just went
+// out of control
+static uint16_t closeSubgroup()
+{
+    struct spcLimits* l;
+    uint16_t state = 0, fresh = 0;
+    uint8_t i, bits;
+
+    subgroups++;
+    for (i = 0; i < 3; i++)
+    {
+        l = &limits[i];
+        l->xbar = ((uint64_t)groupSum[i] << SPC_FRAC) / subgroup;
+        l->range = (uint32_t)(groupMax[i] - groupMin[i]) << SPC_FRAC;
+        if (!haveLimits)
+        {
+            xbarSum[i] += l->xbar;
+            rangeSum[i] += l->range;
+            continue;
+        }
+        bits = 0;
+        if (l->xbar > l->xbarUpper)
+            bits |= SPC_XBAR_HIGH;
+        if (l->xbar < l->xbarLower)
+            bits |= SPC_XBAR_LOW;
+        if (l->range > l->rangeUpper)
+            bits |= SPC_RANGE_HIGH;
+        if (l->range < l->rangeLower)
+            bits |= SPC_RANGE_LOW;
+        if (bits)
+            l->alarms++;
+        state |= bits << (4 * i);
+    }
+    if (!haveLimits && ++baselineCount == SPC_BASELINE)
+        setLimits();
+    for (i = 0; i < 3; i++)
+        if (SPC_ALARMS(state, i) && !SPC_ALARMS(alarmState, i))
+            fresh |= state & (0x0F << (4 * i));
+    alarmState = state;
+    return fresh;
+}
+
+// Adds a red, green, blue sample; returns the alarm bits (SPC_ALARMS) of the
+// channels that went out of control with it, 0 almost always
+uint16_t addSpcSample(const uint16_t* rgb)
+{
+    uint16_t alarms = 0;
+    uint8_t i;
+
+    samples++;
+    for (i = 0; i < 3; i++)
+    {
+        addWelford(&current[i], rgb[i]);
+        if (groupCount == 0)
+        {
+            groupSum[i] = 0;
+            groupMin[i] = groupMax[i] = rgb[i];
+        }
+        groupSum[i] += rgb[i];
+        if (rgb[i] < groupMin[i])
+            groupMin[i] = rgb[i];
+        if (rgb[i] > groupMax[i])
+            groupMax[i] = rgb[i];
+    }
+    if (current[0].count == window)
+    {
+        for (i = 0; i < 3; i++)
+        {
+            latched[i] = current[i];
+            resetWelford(&current[i]);
+        }
+        haveLatched = true;
+    }
+    if (++groupCount == subgroup)
+    {
+        groupCount = 0;
+        alarms = closeSubgroup();
+    }
+    return alarms;
+}
+
+// Statistics of the window being collected (current) or of the last complete
+// one; false if there is none yet
+bool getSpcStats(uint8_t channel, bool running, struct spcStats* stats)
+{
+    const struct welford* w = running ? &current[channel] : &latched[channel];
+    int64_t m2 = w->m2 < 0 ? 0 : w->m2;
+
+    if ((!running && !haveLatched) || w->count == 0)
+        return false;
+    stats->count = w->count;
+    stats->mean = w->mean;
+    stats->sigma = w->count > 1 ? isqrt64(m2 / (w->count - 1)) : 0;
+    stats->min = w->min;
+    stats->max = w->max;
+    return true;
+}
+
+// Control limits of a channel; false while the baseline is being collected
+bool getSpcLimits(uint8_t channel, struct spcLimits* copy)
+{
+    if (!haveLimits)
+        return false;
+    *copy = limits[channel];
+    return true;
+}
+
+uint32_t getSpcSamples()
+{
+    return samples;
+}
+
+uint32_t getSpcSubgroups()
+{
+    return subgroups;
+}
+
+uint16_t getSpcAlarmState()
+{
+    return alarmState;
+}
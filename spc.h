@@ -0,0 +1,69 @@
+// Statistical process control functions
+// Rolling per-channel statistics and X-bar/R control-limit alarms
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef SPC_H_
+#define SPC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SPC_WINDOW      100         // default samples per statistics window
+#define SPC_SUBGROUP    5           // default samples per X-bar/R subgroup
+#define SPC_SUBGROUP_MIN 2
+#define SPC_SUBGROUP_MAX 10
+#define SPC_BASELINE    20          // subgroups that set the control limits
+#define SPC_FRAC        8           // means, deviations and limits are Q8
+
+// Alarm bits per channel, shifted left by 4 x channel
+#define SPC_XBAR_HIGH   0x01
+#define SPC_XBAR_LOW    0x02
+#define SPC_RANGE_HIGH  0x04
+#define SPC_RANGE_LOW   0x08
+#define SPC_ALARMS(mask, channel) (((mask) >> (4 * (channel))) & 0x0F)
+
+// Window statistics of one channel, in 16-bit sample units
+struct spcStats
+{
+    uint16_t count;
+    uint32_t mean;                  // Q8
+    uint32_t sigma;                 // sample standard deviation, Q8
+    uint16_t min;
+    uint16_t max;
+};
+
+// Control limits of one channel, Q8, and the last subgroup checked against them
+struct spcLimits
+{
+    uint32_t xbarCenter;
+    uint32_t xbarUpper;
+    uint32_t xbarLower;
+    uint32_t rangeCenter;
+    uint32_t rangeUpper;
+    uint32_t rangeLower;
+    uint32_t xbar;
+    uint32_t range;
+    uint32_t alarms;                // subgroups outside the limits
+};
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void startSpc(uint16_t samplesPerWindow, uint8_t samplesPerGroup);
+uint16_t getSpcWindow();
+uint8_t getSpcSubgroup();
+uint16_t addSpcSample(const uint16_t* rgb);
+bool getSpcStats(uint8_t channel, bool running, struct spcStats* stats);
+bool getSpcLimits(uint8_t channel, struct spcLimits* copy);
+uint32_t getSpcSamples();
+uint32_t getSpcSubgroups();
+uint16_t getSpcAlarmState();
+
+#endif
@@ -0,0 +1,361 @@
+// Store functions
+// Log-structured EEPROM record store with background compaction
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Records are single EEPROM words appended to the active segment, so saving
+// one entry costs one word program. The client replays them in order at boot
+// and later records override earlier ones. Each segment starts with a header
+// word holding a sequence number; the valid header with the highest sequence
+// marks the active segment.
+//
+// Once the active segment holds STORE_COMPACT_AT records, storeBackground()
+// copies the live records (from the client's snapshot callback) into the next
+// segment one word per call, then writes its header, which is the commit
+// point. Records appended during the copy go to both segments, after the copy
+// of their entry or before it, so the target always ends up current. The old
+// segment is then blanked word by word in the background, ready for the next
+// rotation. If the active segment fills up first, the remaining work is done
+// synchronously inside storeAppend().
+//
+// Power loss before the header write leaves the old segment active; the
+// partial copy is blanked again before it is reused.
+//
+// Writes are counted per segment and appends are timed with the cycle
+// counter, so the cost of a save can be checked against rewriting an image.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hal.h"
+#include "eeprom.h"
+#include "store.h"
+
+#define HEADER_TAG      0x4C470000  // "LG" and a 16-bit sequence
+#define NO_SEGMENT      0xFF
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static uint16_t storeIndexes;
+static bool (*storeSnapshot)(uint16_t index, uint32_t* record);
+
+static uint8_t active = NO_SEGMENT;
+static uint16_t sequence = 0;
+static uint16_t records = 0;                // records in the active segment
+
+static bool compacting = false;
+static uint8_t target;
+static uint16_t targetRecords;
+static uint16_t copyIndex;
+
+static uint8_t eraseSegment = NO_SEGMENT;
+static uint16_t eraseWord;
+
+static uint32_t writes[STORE_SEGMENTS];
+static uint32_t appends = 0;
+static uint32_t compactions = 0;
+static uint32_t lastLatency = 0;            // append time in system clocks
+static uint32_t maxLatency = 0;
+static uint64_t totalLatency = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static uint32_t wordAddress(uint8_t segment, uint16_t word)
+{
+    return STORE_ADDRESS + ((uint32_t)segment * STORE_SEGMENT_WORDS + word) * 4;
+}
+
+static uint32_t readWord(uint8_t segment, uint16_t word)
+{
+    uint32_t value;
+
+    EEPROMRead(&value, wordAddress(segment, word), 4);
+    return value;
+}
+
+static bool programWord(uint8_t segment, uint16_t word, uint32_t value)
+{
+    writes[segment]++;
+    return EEPROMProgram(&value, wordAddress(segment, word), 4) == 0;
+}
+
+static bool isHeader(uint32_t word)
+{
+    return (word & 0xFFFF0000) == HEADER_TAG && (word & 0xFFFF) != 0;
+}
+
+// Sequence a is newer than b, allowing for wrap
+static bool isNewer(uint16_t a, uint16_t b)
+{
+    return (int16_t)(a - b) > 0;
+}
+
+static uint8_t nextSegment(uint8_t segment)
+{
+    return (segment + 1) % STORE_SEGMENTS;
+}
+
+static uint16_t nextSequence(uint16_t seq)
+{
+    return seq == 0xFFFF ? 1 : seq + 1;
+}
+
+static bool isSegmentBlank(uint8_t segment)
+{
+    uint16_t i;
+
+    for (i = 0; i < STORE_SEGMENT_WORDS; i++)
+        if (readWord(segment, i) != STORE_BLANK)
+            return false;
+    return true;
+}
+
+// Finds the active segment and its record count; the client supplies the live
+// record of each of its indexes for compaction
+void storeInit(uint16_t indexes, bool (*snapshot)(uint16_t index, uint32_t* record))
+{
+    uint32_t header;
+    uint8_t s;
+
+    storeIndexes = indexes;
+    storeSnapshot = snapshot;
+    active = NO_SEGMENT;
+    sequence = 0;
+    compacting = false;
+    for (s = 0; s < STORE_SEGMENTS; s++)
+    {
+        header = readWord(s, 0);
+        if (isHeader(header) && (active == NO_SEGMENT || isNewer(header & 0xFFFF, sequence)))
+        {
+            active = s;
+            sequence = header & 0xFFFF;
+        }
+    }
+    records = 0;
+    if (active != NO_SEGMENT)
+        while (records < STORE_SEGMENT_WORDS - 1 && readWord(active, records + 1) != STORE_BLANK)
+            records++;
+    // stale or half-copied segments are blanked before they are reused
+    eraseSegment = NO_SEGMENT;
+    for (s = 0; s < STORE_SEGMENTS && active != NO_SEGMENT; s++)
+    {
+        if (s != active && !isSegmentBlank(s))
+        {
+            eraseSegment = s;
+            eraseWord = 0;
+            break;
+        }
+    }
+}
+
+bool isStoreFormatted()
+{
+    return active != NO_SEGMENT;
+}
+
+// Record i of the active segment, 0 is the oldest
+uint32_t readStoreRecord(uint16_t i)
+{
+    return readWord(active, i + 1);
+}
+
+// Blanks one word of the retired segment
+static bool eraseStep()
+{
+    bool ok = true;
+
+    if (readWord(eraseSegment, eraseWord) != STORE_BLANK)
+        ok = programWord(eraseSegment, eraseWord, STORE_BLANK);
+    if (++eraseWord == STORE_SEGMENT_WORDS)
+        eraseSegment = NO_SEGMENT;
+    return ok;
+}
+
+// Starts copying into segment, blanking it first if a copy was cut short
+static void startCompaction(uint8_t segment)
+{
+    compacting = true;
+    target = segment;
+    targetRecords = 0;
+    copyIndex = 0;
+    if (eraseSegment != target && !isSegmentBlank(target))
+    {
+        eraseSegment = target;
+        eraseWord = 0;
+    }
+}
+
+// Copies one live record, or commits the target once all are copied
+static bool compactStep()
+{
+    uint32_t record;
+    bool ok = true;
+
+    while (copyIndex < storeIndexes && !storeSnapshot(copyIndex, &record))
+        copyIndex++;
+    if (copyIndex < storeIndexes)
+    {
+        ok = programWord(target, 1 + targetRecords++, record);
+        copyIndex++;
+        return ok;
+    }
+    sequence = nextSequence(sequence);
+    ok = programWord(target, 0, HEADER_TAG | sequence);
+    if (active != NO_SEGMENT)
+    {
+        eraseSegment = active;
+        eraseWord = 0;
+    }
+    active = target;
+    records = targetRecords;
+    compacting = false;
+    compactions++;
+    return ok;
+}
+
+// One bounded step of background work (one EEPROM word at most); returns
+// true while there is more to do
+bool storeBackground()
+{
+    if (eraseSegment != NO_SEGMENT && (!compacting || eraseSegment == target))
+        eraseStep();
+    else if (compacting)
+        compactStep();
+    else if (active != NO_SEGMENT && records >= STORE_COMPACT_AT)
+        startCompaction(nextSegment(active));
+    return eraseSegment != NO_SEGMENT || compacting || (active != NO_SEGMENT && records >= STORE_COMPACT_AT);
+}
+
+// Finishes any erase and compaction in progress
+static bool finishWork()
+{
+    bool ok = true;
+
+    while (eraseSegment != NO_SEGMENT && (!compacting || eraseSegment == target))
+        ok &= eraseStep();
+    while (compacting)
+        ok &= compactStep();
+    return ok;
+}
+
+// Writes the live records into a fresh segment now (first use, migration).
+// Without an active segment the first blank one is used, so an old image
+// elsewhere survives until the new segment is committed.
+bool storeRebuild()
+{
+    uint8_t s = 0;
+    bool ok = finishWork();
+
+    if (active != NO_SEGMENT)
+        s = nextSegment(active);
+    else
+        while (s < STORE_SEGMENTS - 1 && !isSegmentBlank(s))
+            s++;
+    startCompaction(s);
+    ok &= finishWork();
+    // a segment left without a header (old image) is blanked in the background
+    for (s = 0; s < STORE_SEGMENTS && eraseSegment == NO_SEGMENT; s++)
+    {
+        if (s != active && !isSegmentBlank(s))
+        {
+            eraseSegment = s;
+            eraseWord = 0;
+        }
+    }
+    return ok;
+}
+
+// Appends one record; the caller has already applied it to the live state the
+// snapshot callback reports
+bool storeAppend(uint32_t record)
+{
+    uint32_t start = readCycleCounter();
+    bool ok = true;
+
+    if (active == NO_SEGMENT)
+        ok = storeRebuild();                // first record: the snapshot has it
+    else if (records == STORE_SEGMENT_WORDS - 1)
+    {
+        // full: rotate now; a copy in progress may have passed this entry
+        if (!compacting)
+            startCompaction(nextSegment(active));
+        else if (eraseSegment != target)
+            ok = programWord(target, 1 + targetRecords++, record);
+        ok &= finishWork();
+    }
+    else
+    {
+        ok = programWord(active, 1 + records++, record);
+        if (compacting && eraseSegment != target)
+            ok &= programWord(target, 1 + targetRecords++, record);
+    }
+    appends++;
+    lastLatency = readCycleCounter() - start;
+    if (lastLatency > maxLatency)
+        maxLatency = lastLatency;
+    totalLatency += lastLatency;
+    return ok;
+}
+
+uint8_t getStoreSegment()
+{
+    return active;
+}
+
+uint16_t getStoreSequence()
+{
+    return sequence;
+}
+
+uint16_t getStoreRecords()
+{
+    return records;
+}
+
+uint32_t getStoreWrites(uint8_t segment)
+{
+    return writes[segment];
+}
+
+uint32_t getStoreAppends()
+{
+    return appends;
+}
+
+uint32_t getStoreCompactions()
+{
+    return compactions;
+}
+
+// Append latency in microseconds
+uint32_t getStoreLastLatency()
+{
+    return lastLatency / (SYSTEM_CLOCK / 1000000);
+}
+
+uint32_t getStoreMaxLatency()
+{
+    return maxLatency / (SYSTEM_CLOCK / 1000000);
+}
+
+uint32_t getStoreAverageLatency()
+{
+    return appends == 0 ? 0 : totalLatency / appends / (SYSTEM_CLOCK / 1000000);
+}
+
+uint16_t getStoreErasePending()
+{
+    return eraseSegment == NO_SEGMENT ? 0 : STORE_SEGMENT_WORDS - eraseWord;
+}
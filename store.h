@@ -0,0 +1,44 @@
+// Store functions
+// Log-structured EEPROM record store with background compaction
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef STORE_H_
+#define STORE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define STORE_ADDRESS       0x0     // EEPROM blocks 0-15
+#define STORE_SEGMENTS      2
+#define STORE_SEGMENT_WORDS 128     // 8 blocks: header and 127 one-word records
+#define STORE_COMPACT_AT    119     // records that start a background compaction (8 spare)
+#define STORE_BLANK         0xFFFFFFFF
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void storeInit(uint16_t indexes, bool (*snapshot)(uint16_t index, uint32_t* record));
+bool isStoreFormatted();
+uint32_t readStoreRecord(uint16_t i);
+bool storeAppend(uint32_t record);
+bool storeRebuild();
+bool storeBackground();
+uint8_t getStoreSegment();
+uint16_t getStoreSequence();
+uint16_t getStoreRecords();
+uint32_t getStoreWrites(uint8_t segment);
+uint32_t getStoreAppends();
+uint32_t getStoreCompactions();
+uint32_t getStoreLastLatency();
+uint32_t getStoreMaxLatency();
+uint32_t getStoreAverageLatency();
+uint16_t getStoreErasePending();
+
+#endif
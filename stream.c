@@ -0,0 +1,217 @@
+// Stream functions
+// Back-to-back acquisition shipped to UART0 by uDMA
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// The measurement sequence runs continuously and its interrupt drops each
+// triplet into one of two raw buffers, so the ISR does no formatting. When a
+// buffer fills, the interrupt moves on to the other one and the main loop
+// encodes the full one as a single binary frame (frame.c, up to 30 triplets)
+// and hands it to the uDMA controller, which feeds UART0 while the CPU sleeps.
+// If the interrupt finds the next buffer still waiting to be encoded, its
+// triplets are discarded and counted, a dropped buffer for every STREAM_BUFFER
+// of them. Text output stays queued in uart0.c until the stream stops.
+//
+//   FREE -> FILLING (ISR) -> FULL -> encoded, DMA started -> FREE
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hal.h"
+#include "uart0.h"
+#include "frame.h"
+#include "measure.h"
+#include "stream.h"
+
+#define BUFFER_FREE     0
+#define BUFFER_FILLING  1
+#define BUFFER_FULL     2
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static uint16_t rgbBuffer[2][STREAM_BUFFER][3];
+static uint32_t cycleBuffer[2][STREAM_BUFFER];
+static volatile uint8_t bufferState[2];
+static volatile uint8_t bufferCount[2];
+static volatile uint8_t filling = 0;        // buffer the interrupt writes
+static uint8_t shipping = 0;                // next buffer the main loop encodes
+static uint8_t encoded[FRAME_ENCODED_MAX + 1];  // frame on its way out, plus delimiter
+static const uint8_t delimiter = 0;
+
+static bool streaming = false;
+static bool haveCycles;
+static uint32_t lastCycles;
+static uint64_t elapsed;                    // clocks from the first to the last triplet
+static volatile uint32_t samples;
+static volatile uint32_t droppedSamples;
+static volatile uint32_t droppedBuffers;
+static uint32_t dropRun;                    // triplets dropped since the last one stored
+static uint32_t frames;
+static uint32_t bytes;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Measurement interrupt: stores a triplet, or counts it if there is no room
+static void streamSink(const uint16_t* rgb, uint32_t cycles)
+{
+    uint8_t n;
+
+    if (haveCycles)
+        elapsed += cycles - lastCycles;
+    haveCycles = true;
+    lastCycles = cycles;
+    if (bufferState[filling] == BUFFER_FREE)
+    {
+        bufferState[filling] = BUFFER_FILLING;
+        bufferCount[filling] = 0;
+    }
+    if (bufferState[filling] != BUFFER_FILLING)
+    {
+        if (dropRun++ % STREAM_BUFFER == 0)
+            droppedBuffers++;
+        droppedSamples++;
+        return;
+    }
+    dropRun = 0;
+    n = bufferCount[filling];
+    rgbBuffer[filling][n][0] = rgb[0];
+    rgbBuffer[filling][n][1] = rgb[1];
+    rgbBuffer[filling][n][2] = rgb[2];
+    cycleBuffer[filling][n] = cycles;
+    bufferCount[filling] = ++n;
+    samples++;
+    if (n == STREAM_BUFFER)
+    {
+        bufferState[filling] = BUFFER_FULL;
+        filling ^= 1;
+    }
+}
+
+// Starts streaming with the given red, green, blue pwm values; returns false if
+// a measurement is already running
+bool startStream(const uint32_t* pwm)
+{
+    if (streaming || isMeasuring())
+        return false;
+    bufferState[0] = bufferState[1] = BUFFER_FREE;
+    filling = shipping = 0;
+    haveCycles = false;
+    elapsed = 0;
+    samples = droppedSamples = droppedBuffers = dropRun = 0;
+    frames = bytes = 0;
+    resetFrames();
+    flushUart0();
+    holdUart0Tx(true);
+    startUart0TxDma(&delimiter, 1);         // whatever the receiver had so far ends here
+    bytes = 1;
+    streaming = true;
+    if (!startContinuous(pwm, streamSink))
+    {
+        stopStream();
+        return false;
+    }
+    return true;
+}
+
+// Stops the acquisition, sends what is buffered and gives UART0 back
+void stopStream()
+{
+    uint32_t state;
+
+    if (!streaming)
+        return;
+    stopMeasurement();
+    state = disableInterrupts();
+    if (bufferState[filling] == BUFFER_FILLING)
+        bufferState[filling] = BUFFER_FULL;
+    restoreInterrupts(state);
+    while (bufferState[0] != BUFFER_FREE || bufferState[1] != BUFFER_FREE || isUart0TxDmaBusy())
+    {
+        streamBackground();
+        state = disableInterrupts();
+        if (isUart0TxDmaBusy())
+            waitForInterrupt();
+        restoreInterrupts(state);
+    }
+    while (isUart0Busy());
+    streaming = false;
+    holdUart0Tx(false);
+}
+
+bool isStreaming()
+{
+    return streaming;
+}
+
+// True if a full buffer can be encoded now, i.e. the main loop must not sleep
+bool isStreamReady()
+{
+    return streaming && bufferState[shipping] == BUFFER_FULL && !isUart0TxDmaBusy();
+}
+
+// Main loop: encodes the oldest full buffer and starts its transfer once the
+// previous one is done
+void streamBackground()
+{
+    uint16_t length;
+
+    if (!isStreamReady())
+        return;
+    length = encodeFrame((const uint16_t (*)[3])rgbBuffer[shipping], cycleBuffer[shipping],
+                         bufferCount[shipping], encoded);
+    if (length == 0)
+    {
+        droppedBuffers++;                   // cannot happen at stream rates, offsets fit
+        droppedSamples += bufferCount[shipping];
+    }
+    bufferState[shipping] = BUFFER_FREE;
+    shipping ^= 1;
+    if (length == 0)
+        return;
+    startUart0TxDma(encoded, length);
+    frames++;
+    bytes += length;
+}
+
+uint32_t getStreamSamples()
+{
+    return samples;
+}
+
+uint32_t getStreamFrames()
+{
+    return frames;
+}
+
+uint32_t getStreamBytes()
+{
+    return bytes;
+}
+
+uint32_t getStreamDroppedBuffers()
+{
+    return droppedBuffers;
+}
+
+uint32_t getStreamDroppedSamples()
+{
+    return droppedSamples;
+}
+
+// System clocks from the first triplet to the last
+uint64_t getStreamClocks()
+{
+    return elapsed;
+}
@@ -0,0 +1,36 @@
+// Stream functions
+// Back-to-back acquisition shipped to UART0 by uDMA
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "frame.h"
+
+#define STREAM_BUFFER   FRAME_COUNT_MAX     // triplets per buffer, one frame each
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+bool startStream(const uint32_t* pwm);
+void stopStream();
+bool isStreaming();
+bool isStreamReady();
+void streamBackground();
+uint32_t getStreamSamples();
+uint32_t getStreamFrames();
+uint32_t getStreamBytes();
+uint32_t getStreamDroppedBuffers();
+uint32_t getStreamDroppedSamples();
+uint64_t getStreamClocks();
+
+#endif
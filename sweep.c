@@ -0,0 +1,162 @@
+// Sweep functions
+// Timer-triggered PWM sweeps for calibrate and test
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Timer3A runs periodically and triggers ADC0 SS2 in hardware (ADC_EMUX), so
+// every point is sampled exactly one period after its pwm value was set, no
+// matter what the CPU is doing. The SS2 interrupt stores the sample and writes
+// the next pwm compare value, which then settles for a full period.
+// A sweep either steps linearly through every pwm value or bisects for the
+// first value whose sample is above a threshold, relying on the pwm to light
+// response being monotonic.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "hal.h"
+#include "sweep.h"
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static uint32_t sweepPeriod = 10000;        // us per point
+static uint8_t sweepChannel;
+static uint16_t sweepThreshold;             // 0 = run all steps
+static uint16_t* sweepSamples;              // NULL = don't record
+static volatile uint16_t sweepStep;         // pwm value being sampled
+static volatile bool sweepDone;
+static bool sweepSearch;                    // bisect instead of stepping
+static uint16_t searchLow;                  // all pwm below are known <= threshold
+static uint16_t searchHigh;                 // first pwm known > threshold
+static volatile uint8_t searchSteps;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static void setSweepPwm(uint16_t pwm)
+{
+    if (sweepChannel == SWEEP_RED)
+        setRgbColor(pwm, 0, 0);
+    else if (sweepChannel == SWEEP_GREEN)
+        setRgbColor(0, pwm, 0);
+    else
+        setRgbColor(0, 0, pwm);
+}
+
+// Sleeps until adc0Ss2Isr() ends the sweep. The ISR stops Timer3 as it sets
+// sweepDone, so the test is made with interrupts masked: a completion between
+// the test and the WFI would leave nothing to wake the CPU.
+static void waitForSweep()
+{
+    uint32_t state;
+
+    while (!sweepDone)
+    {
+        state = disableInterrupts();
+        if (!sweepDone)
+            waitForInterrupt();
+        restoreInterrupts(state);
+    }
+}
+
+void setSweepPeriod(uint32_t us)
+{
+    sweepPeriod = us < 10 ? 10 : us;
+}
+
+uint32_t getSweepPeriod()
+{
+    return sweepPeriod;
+}
+
+// Steps one LED from pwm 0 upward, one point per sweep period. Returns the
+// number of points sampled: SWEEP_STEPS, or fewer if a sample went above a
+// non-zero threshold (that sample is the last one).
+uint16_t runSweep(uint8_t channel, uint16_t threshold, uint16_t* samples)
+{
+    sweepChannel = channel;
+    sweepThreshold = threshold;
+    sweepSamples = samples;
+    sweepStep = 0;
+    sweepDone = false;
+    sweepSearch = false;
+
+    setSweepPwm(0);
+    startSweepTimer(sweepPeriod);
+    waitForSweep();
+    stopSweepTimer();
+    setRgbColor(0, 0, 0);
+    return sweepStep + 1;
+}
+
+// Bisects one LED for the first pwm value whose sample is above threshold,
+// one point per sweep period. Returns that pwm value, or SWEEP_STEPS if even
+// full brightness stays at or below the threshold. steps receives the number
+// of points sampled (10 for 1024 pwm values).
+uint16_t searchSweep(uint8_t channel, uint16_t threshold, uint8_t* steps)
+{
+    sweepChannel = channel;
+    sweepThreshold = threshold;
+    sweepSamples = NULL;
+    searchLow = 0;
+    searchHigh = SWEEP_STEPS;
+    searchSteps = 0;
+    sweepStep = SWEEP_STEPS / 2;
+    sweepDone = false;
+    sweepSearch = true;
+
+    setSweepPwm(sweepStep);
+    startSweepTimer(sweepPeriod);
+    waitForSweep();
+    stopSweepTimer();
+    setRgbColor(0, 0, 0);
+    *steps = searchSteps;
+    return searchHigh;
+}
+
+// ADC0 SS2 conversion triggered by Timer3A
+void adc0Ss2Isr()
+{
+    uint16_t raw = readAdc0Ss2Result();
+
+    if (sweepDone)
+        return;
+    if (sweepSearch)
+    {
+        searchSteps++;
+        if (raw > sweepThreshold)
+            searchHigh = sweepStep;
+        else
+            searchLow = sweepStep + 1;
+        if (searchLow >= searchHigh)
+        {
+            stopSweepTimer();
+            sweepDone = true;
+            return;
+        }
+        sweepStep = (searchLow + searchHigh) / 2;
+        setSweepPwm(sweepStep);
+        return;
+    }
+    if (sweepSamples != NULL)
+        sweepSamples[sweepStep] = raw;
+    if ((sweepThreshold != 0 && raw > sweepThreshold) || sweepStep == SWEEP_STEPS - 1)
+    {
+        stopSweepTimer();
+        sweepDone = true;
+        return;
+    }
+    setSweepPwm(++sweepStep);
+}
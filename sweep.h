@@ -0,0 +1,32 @@
+// Sweep functions
+// Timer-triggered PWM sweeps for calibrate and test
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef SWEEP_H_
+#define SWEEP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SWEEP_STEPS     1024        // pwm 0-1023
+#define SWEEP_RED       0
+#define SWEEP_GREEN     1
+#define SWEEP_BLUE      2
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void setSweepPeriod(uint32_t us);
+uint32_t getSweepPeriod();
+uint16_t runSweep(uint8_t channel, uint16_t threshold, uint16_t* samples);
+uint16_t searchSweep(uint8_t channel, uint16_t threshold, uint8_t* steps);
+void adc0Ss2Isr();
+
+#endif
@@ -0,0 +1,109 @@
+// Token functions
+// Single-pass command line lexer with parsed numeric fields
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Fields are runs of letters, digits, '.' and '-'; anything else separates
+// them. One walk over the line records each field's offset and length and
+// accumulates numbers as the digits go by, so nothing is copied and no field
+// is scanned twice. Handlers compare words in place with isTokenText().
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "token.h"
+
+#define VALUE_MAX       0xFFFFFFFF
+#define VALUE_TENTH     (VALUE_MAX / 10)    // largest value that can take another digit
+#define VALUE_LAST      (VALUE_MAX % 10)    // and the largest digit it can take
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static bool isLetter(char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+// Splits str into fields, filling up to max tokens. Returns the number of
+// fields in the line, which is more than max if some did not fit.
+uint8_t tokenize(const char* str, struct token* tokens, uint8_t max)
+{
+    struct token* token = NULL;
+    bool inField = false;
+    uint8_t count = 0;
+    uint8_t i;
+    char c;
+
+    for(i = 0; (c = str[i]) != '\0'; i++)
+    {
+        bool digit = isDigit(c);
+
+        if(!digit && !isLetter(c) && c != '.' && c != '-')
+        {
+            inField = false;                // delimiter ends the field
+            token = NULL;
+            continue;
+        }
+        if(!inField)                        // first character of a field
+        {
+            inField = true;
+            token = count < max ? &tokens[count] : NULL;
+            if(count < 255)
+                count++;
+            if(token == NULL)
+                continue;                   // counted, not stored
+            token->offset = i;
+            token->length = 0;
+            token->kind = isLetter(c) ? TOKEN_ALPHA : TOKEN_NUMBER;
+            token->error = 0;
+            token->value = 0;
+        }
+        else if(token == NULL)
+            continue;                       // rest of a field past max
+        token->length++;
+        if(token->kind != TOKEN_NUMBER)
+            continue;
+        if(!digit)
+            token->error |= TOKEN_MALFORMED;
+        else if(token->error == 0)
+        {
+            uint8_t d = c - '0';
+            if(token->value > VALUE_TENTH || (token->value == VALUE_TENTH && d > VALUE_LAST))
+            {
+                token->error |= TOKEN_RANGE;
+                token->value = VALUE_MAX;
+            }
+            else
+                token->value = token->value * 10 + d;
+        }
+    }
+    return count;
+}
+
+// True if the token spells text exactly
+bool isTokenText(const char* str, const struct token* token, const char* text)
+{
+    const char* p = &str[token->offset];
+    uint8_t i;
+
+    for(i = 0; i < token->length; i++)
+        if(p[i] != text[i])
+            return false;
+    return text[i] == '\0';
+}
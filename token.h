@@ -0,0 +1,41 @@
+// Token functions
+// Single-pass command line lexer with parsed numeric fields
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef TOKEN_H_
+#define TOKEN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TOKEN_ALPHA     1           // field starts with a letter
+#define TOKEN_NUMBER    2           // field starts with a digit, '.' or '-'
+
+#define TOKEN_MALFORMED 0x01        // number field holding more than digits
+#define TOKEN_RANGE     0x02        // number does not fit 32 bits
+
+// A field of the line: where it is, what it starts with and, for numbers, its
+// value (the leading digits, 0xFFFFFFFF when out of range) and any error.
+struct token
+{
+    uint8_t offset;
+    uint8_t length;
+    uint8_t kind;
+    uint8_t error;
+    uint32_t value;
+};
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint8_t tokenize(const char* str, struct token* tokens, uint8_t max);
+bool isTokenText(const char* str, const struct token* token, const char* text);
+
+#endif
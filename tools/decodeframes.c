@@ -0,0 +1,159 @@
+// Frame decoder
+// Reference decoder for the binary triplet output (frame.c)
+
+//-----------------------------------------------------------------------------
+// Host tool
+//-----------------------------------------------------------------------------
+
+// Reads the serial byte stream from stdin, splits it at zero bytes, COBS
+// decodes each piece and checks its length and CRC-32. Pieces that fail are
+// counted as other bytes (text lines between frames, damaged frames). Prints
+// the triplets with -v, then a summary: frames, errors, sequence gaps, bytes
+// per triplet and the sample rate from the frame timestamps.
+//
+//   printf 'calibrate\noutput binary 8\nperiodic 1\n' | SIM_RUN_MS=10000 ./colorimeter_sim
+//       | tools/decodeframes -v
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "crc.h"
+#include "frame.h"
+
+#define MAX_PIECE       1024
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static bool verbose = false;
+static uint32_t frames = 0, badFrames = 0, gaps = 0, triplets = 0;
+static uint64_t frameBytes = 0, otherBytes = 0;
+static bool haveSequence = false, haveTime = false;
+static uint16_t nextSequence;
+static uint32_t firstUs, lastUs;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static uint16_t get16(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* p)
+{
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+// Returns the decoded length, or -1 if the piece is not valid COBS
+static int cobsDecode(const uint8_t* in, int length, uint8_t* out)
+{
+    int read = 0, write = 0, i;
+    uint8_t code;
+
+    while (read < length)
+    {
+        code = in[read++];
+        if (code == 0 || read + code - 1 > length)
+            return -1;
+        for (i = 1; i < code; i++)
+            out[write++] = in[read++];
+        if (code != 0xFF && read < length)
+            out[write++] = 0;
+    }
+    return write;
+}
+
+static bool decodeFrame(const uint8_t* piece, int length)
+{
+    uint8_t payload[MAX_PIECE];
+    uint16_t sequence, offset;
+    uint32_t us;
+    int n, count, i;
+    const uint8_t* p;
+
+    n = cobsDecode(piece, length, payload);
+    if (n < FRAME_HEADER + FRAME_CRC || payload[0] != FRAME_TRIPLETS)
+        return false;
+    count = payload[3];
+    if (count < 1 || count > FRAME_COUNT_MAX || n != FRAME_HEADER + count * FRAME_TRIPLET + FRAME_CRC)
+        return false;
+    if (crc32(0, payload, n - FRAME_CRC) != get32(payload + n - FRAME_CRC))
+        return false;
+
+    sequence = get16(payload + 1);
+    if (haveSequence && sequence != nextSequence)
+        gaps++;
+    haveSequence = true;
+    nextSequence = sequence + 1;
+    for (i = 0; i < count; i++)
+    {
+        p = payload + FRAME_HEADER + i * FRAME_TRIPLET;
+        offset = get16(p);
+        us = get32(payload + 4) + (uint32_t)offset * FRAME_TICK_US;
+        if (!haveTime)
+            firstUs = us;
+        haveTime = true;
+        lastUs = us;
+        if (verbose)
+            printf("%5u %10u us  %5u %5u %5u\n", sequence, us, get16(p + 2), get16(p + 4), get16(p + 6));
+    }
+    triplets += count;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    uint8_t piece[MAX_PIECE];
+    int c, length = 0;
+    bool overflow = false;
+    double seconds;
+
+    verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    while ((c = getchar()) != EOF)
+    {
+        if (c != 0)
+        {
+            if (length < MAX_PIECE)
+                piece[length++] = c;
+            else
+                overflow = true;
+            continue;
+        }
+        if (!overflow && length > 0 && decodeFrame(piece, length))
+        {
+            frames++;
+            frameBytes += length + 1;
+        }
+        else
+        {
+            badFrames += length > 0;
+            otherBytes += length + 1;
+        }
+        length = 0;
+        overflow = false;
+    }
+    otherBytes += length;
+
+    printf("%u frames, %u triplets, %u sequence gaps, %u other pieces (%llu bytes)\n",
+           frames, triplets, gaps, badFrames, (unsigned long long)otherBytes);
+    if (triplets > 0)
+        printf("%.2f bytes per triplet\n", (double)frameBytes / triplets);
+    if (triplets > 1 && lastUs != firstUs)
+    {
+        seconds = (lastUs - firstUs) / 1e6;
+        printf("%.1f triplets/s over %.3f s\n", (triplets - 1) / seconds, seconds);
+    }
+    return frames == 0;
+}
@@ -0,0 +1,37 @@
+// Format footprint probe
+// Smallest program that formats a triplet, with fmt.c or with sprintf
+
+//-----------------------------------------------------------------------------
+// Host tool
+//-----------------------------------------------------------------------------
+
+// "make footprint" links this twice, with and without -DUSE_SPRINTF, and
+// prints the sizes of the two images. Everything but the formatting call is
+// the same, so the difference is what sprintf pulls in beyond fmt.c. Built
+// with the target compiler and newlib (see the Makefile), it gives the flash
+// cost on the TM4C123.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdio.h>
+#include "fmt.h"
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    char str[FMT_TRIPLET_MAX];
+    uint16_t value = argc;
+
+#ifdef USE_SPRINTF
+    sprintf(str, "(%u, %u, %u)", value, value, value);
+#else
+    fmtTriplet(str, value, value, value);
+#endif
+    return str[1];
+}
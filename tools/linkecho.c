@@ -0,0 +1,111 @@
+// Link echo
+// Host side of "linktest echo": sends the link test bytes back to the device
+
+//-----------------------------------------------------------------------------
+// Host tool
+//-----------------------------------------------------------------------------
+
+// Starts "linktest echo [bytes]" on the device and sends back, unchanged, the
+// bytes announced by its LINK_ECHO_TAG line, so the test covers the adapter,
+// the cable and this host at the device's current rate. Everything else the
+// device prints is copied to stderr, up to its "Errors:" line. The port is
+// stdin and stdout, set up beforehand:
+//
+//   stty -F /dev/ttyACM0 115200 raw -echo
+//   tools/linkecho 4096 < /dev/ttyACM0 > /dev/ttyACM0
+//
+// Exits with 1 if the device stops answering for LINK_ECHO_TIMEOUT_MS.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include "uart0.h"
+
+#define LINK_ECHO_TIMEOUT_MS 2000
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Reads what is there, up to size bytes, waiting at most the timeout for the
+// first one; returns the count, 0 on timeout or end of input
+static int readSome(uint8_t* data, int size)
+{
+    struct pollfd port = {0, POLLIN, 0};
+    int n;
+
+    if (poll(&port, 1, LINK_ECHO_TIMEOUT_MS) <= 0)
+        return 0;
+    n = read(0, data, size);
+    return n < 0 ? 0 : n;
+}
+
+static bool writeAll(const uint8_t* data, int length)
+{
+    int n;
+
+    while (length > 0)
+    {
+        n = write(1, data, length);
+        if (n <= 0)
+            return false;
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    uint8_t data[256];
+    char line[MAX_CHARS + 1], command[40];
+    uint32_t echo = 0;
+    int length = 0, n, i;
+
+    snprintf(command, sizeof(command), "linktest echo %s\r", argc > 1 ? argv[1] : "");
+    if (!writeAll((const uint8_t*)command, strlen(command)))
+        return 1;
+    while ((n = readSome(data, sizeof(data))) > 0)
+    {
+        for (i = 0; i < n; i++)
+        {
+            if (echo > 0)
+            {
+                // the rest of this read is the device's test bytes, straight back
+                int count = n - i < (int)echo ? n - i : (int)echo;
+                if (!writeAll(&data[i], count))
+                    return 1;
+                echo -= count;
+                i += count - 1;
+                continue;
+            }
+            fputc(data[i], stderr);
+            if (data[i] != '\n' && length < MAX_CHARS)
+            {
+                if (data[i] != '\r')
+                    line[length++] = data[i];
+                continue;
+            }
+            line[length] = '\0';
+            length = 0;
+            if (strncmp(line, LINK_ECHO_TAG, strlen(LINK_ECHO_TAG)) == 0)
+                echo = strtoul(line + strlen(LINK_ECHO_TAG), NULL, 10);
+            else if (strncmp(line, "Errors:", 7) == 0 || strncmp(line, "Status:", 7) == 0)
+                return 0;
+        }
+    }
+    fprintf(stderr, "\nlinkecho: no answer from the device\n");
+    return 1;
+}
@@ -0,0 +1,181 @@
+// Command table generator
+// Writes the command table (command_data.c) from a list of commands
+
+//-----------------------------------------------------------------------------
+// Host tool
+//-----------------------------------------------------------------------------
+
+// Reads one "name, handler, arguments, menu, usage, help" line per command
+// from stdin, skipping blank lines and lines starting with #, and writes C
+// source for commandTable to stdout. The help text is the rest of the line,
+// so it may hold commas. Multipliers are tried until commandHash() puts
+// every name in its own slot; the first that works is written out with the
+// slots, so the firmware looks commands up without a search.
+//
+//   tools/mkcommands < commands.csv > command_data.c
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "command.h"
+
+#define FIELDS          6
+#define LINE_MAX        200
+#define MAX_TRIES       10000000
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Strips leading and trailing blanks in place
+static char* trim(char* s)
+{
+    char* end;
+
+    while (*s == ' ' || *s == '\t')
+        s++;
+    end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r'))
+        *--end = '\0';
+    return s;
+}
+
+// Prints s as a C string literal
+static void printString(const char* s)
+{
+    putchar('"');
+    for (; *s != '\0'; s++)
+    {
+        if (*s == '"' || *s == '\\')
+            putchar('\\');
+        putchar(*s);
+    }
+    putchar('"');
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(void)
+{
+    static char lines[COMMAND_MAX][LINE_MAX];
+    static char* field[COMMAND_MAX][FIELDS];
+    uint8_t slot[COMMAND_SLOTS];
+    uint32_t count = 0, lineNumber = 0, tries, i, j;
+    uint32_t multiplier = 0, seed = 1;
+    char line[LINE_MAX];
+    bool collision = true;
+
+    while (fgets(line, sizeof(line), stdin) != NULL)
+    {
+        char* p = line;
+
+        lineNumber++;
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+            continue;
+        if (count == COMMAND_MAX)
+        {
+            fprintf(stderr, "mkcommands: more than %u commands\n", COMMAND_MAX);
+            return 1;
+        }
+        strcpy(lines[count], line);
+        p = lines[count];
+        for (i = 0; i < FIELDS - 1; i++)
+        {
+            char* comma = strchr(p, ',');
+            if (comma == NULL)
+            {
+                fprintf(stderr, "mkcommands: line %lu: expected %u fields\n", (unsigned long)lineNumber, FIELDS);
+                return 1;
+            }
+            *comma = '\0';
+            field[count][i] = trim(p);
+            p = comma + 1;
+        }
+        field[count][FIELDS - 1] = trim(p);
+        if (strcmp(field[count][3], "main") != 0 && strcmp(field[count][3], "prom") != 0
+                && strcmp(field[count][3], "hidden") != 0)
+        {
+            fprintf(stderr, "mkcommands: line %lu: menu is main, prom or hidden\n", (unsigned long)lineNumber);
+            return 1;
+        }
+        if (strspn(field[count][2], "na*|") != strlen(field[count][2]))
+        {
+            fprintf(stderr, "mkcommands: line %lu: arguments are n, a, * and |\n", (unsigned long)lineNumber);
+            return 1;
+        }
+        for (j = 0; j < count; j++)
+        {
+            if (strcmp(field[j][0], field[count][0]) == 0)
+            {
+                fprintf(stderr, "mkcommands: line %lu: %s listed twice\n", (unsigned long)lineNumber, field[count][0]);
+                return 1;
+            }
+        }
+        count++;
+    }
+
+    // odd multipliers from a fixed LCG, so the output only changes with the list
+    for (tries = 0; tries < MAX_TRIES && collision; tries++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        multiplier = seed | 1;
+        memset(slot, 0, sizeof(slot));
+        collision = false;
+        for (i = 0; i < count && !collision; i++)
+        {
+            uint8_t h = commandHash(field[i][0], strlen(field[i][0]), multiplier);
+            if (slot[h] != 0)
+                collision = true;
+            slot[h] = i + 1;
+        }
+    }
+    if (collision)
+    {
+        fprintf(stderr, "mkcommands: no collision-free multiplier in %u tries\n", MAX_TRIES);
+        return 1;
+    }
+
+    printf("// Command table\n");
+    printf("// Generated by tools/mkcommands from commands.csv, do not edit\n\n");
+    printf("#include <stdint.h>\n#include <stdbool.h>\n#include \"command.h\"\n\n");
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; j < i && strcmp(field[j][1], field[i][1]) != 0; j++)
+            ;
+        if (j == i)
+            printf("void %s();\n", field[i][1]);
+    }
+    printf("\n// %lu commands\n", (unsigned long)count);
+    printf("static const struct command commands[%lu] =\n{\n", (unsigned long)(count ? count : 1));
+    for (i = 0; i < count; i++)
+    {
+        printf("    {");
+        printString(field[i][0]);
+        printf(", %s, ", field[i][1]);
+        printString(field[i][2]);
+        printf(",\n        ");
+        printString(field[i][4]);
+        printf(",\n        ");
+        printString(field[i][5]);
+        printf(", COMMAND_%s},\n", strcmp(field[i][3], "main") == 0 ? "MAIN"
+               : strcmp(field[i][3], "prom") == 0 ? "PROM" : "HIDDEN");
+    }
+    if (count == 0)
+        printf("    {\"\", 0, \"\", \"\", \"\", COMMAND_HIDDEN},\n");
+    printf("};\n\n");
+    printf("static const uint8_t commandSlot[COMMAND_SLOTS] =\n{\n");
+    for (i = 0; i < COMMAND_SLOTS; i++)
+        printf("%s%u,%s", i % 16 == 0 ? "    " : " ", slot[i], i % 16 == 15 ? "\n" : "");
+    printf("};\n\n");
+    printf("const struct commandTable commandTable = {commands, commandSlot, 0x%08lXu, %lu};\n",
+           (unsigned long)multiplier, (unsigned long)count);
+    return 0;
+}
@@ -0,0 +1,97 @@
+// Library generator
+// Writes the flash reference library (library_data.c) from a list of colors
+
+//-----------------------------------------------------------------------------
+// Host tool
+//-----------------------------------------------------------------------------
+
+// Reads one "r,g,b" color (0-255 each) per line from stdin, skipping blank
+// lines and lines starting with #, and writes C source for referenceLibrary to
+// stdout: the colors sorted by grid cell, their line numbers as ids and the
+// cell start index, all const so they stay in flash. Colors are packed
+// 0x00BBGGRR words.
+//
+//   tools/mklibrary < library.csv > library_data.c
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "distance.h"
+#include "library.h"
+
+#define MAX_ENTRIES     65535
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(void)
+{
+    static uint8_t rgb[MAX_ENTRIES][3];
+    static uint32_t sortedRgb[MAX_ENTRIES];
+    static uint16_t sortedId[MAX_ENTRIES];
+    static uint16_t lineOf[MAX_ENTRIES];
+    static uint16_t cellStart[(1 << (3 * LIBRARY_MAX_BITS)) + 1];
+    char line[100];
+    unsigned r, g, b;
+    uint32_t count = 0, lineNumber = 0, i;
+    uint16_t cells;
+    uint8_t bits;
+
+    while (fgets(line, sizeof(line), stdin) != NULL)
+    {
+        lineNumber++;
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+            continue;
+        if (sscanf(line, "%u,%u,%u", &r, &g, &b) != 3 || r > 255 || g > 255 || b > 255)
+        {
+            fprintf(stderr, "mklibrary: line %lu: expected r,g,b\n", (unsigned long)lineNumber);
+            return 1;
+        }
+        if (count == MAX_ENTRIES || lineNumber > 65535)
+        {
+            fprintf(stderr, "mklibrary: more than %u lines\n", MAX_ENTRIES);
+            return 1;
+        }
+        rgb[count][0] = r;
+        rgb[count][1] = g;
+        rgb[count][2] = b;
+        lineOf[count] = lineNumber;
+        count++;
+    }
+
+    bits = libraryGridBits(count);
+    cells = libraryCells(bits);
+    libraryBuild((const uint8_t (*)[3])rgb, count, bits, sortedRgb, sortedId, cellStart);
+    for (i = 0; i < count; i++)
+        sortedId[i] = lineOf[sortedId[i]];
+
+    printf("// Reference color library\n");
+    printf("// Generated by tools/mklibrary from library.csv, do not edit\n\n");
+    printf("#include <stdint.h>\n#include <stdbool.h>\n#include \"library.h\"\n\n");
+    printf("// %lu colors, %u x %u x %u grid\n", (unsigned long)count, 1 << bits, 1 << bits, 1 << bits);
+    printf("static const uint32_t libraryRgb[%lu] =\n{\n", (unsigned long)(count ? count : 1));
+    for (i = 0; i < count; i++)
+        printf("%s0x%06lX,%s", i % 8 == 0 ? "    " : " ", (unsigned long)sortedRgb[i], i % 8 == 7 || i == count - 1 ? "\n" : "");
+    if (count == 0)
+        printf("    0,\n");
+    printf("};\n\n");
+    printf("static const uint16_t libraryId[%lu] =\n{\n", (unsigned long)(count ? count : 1));
+    for (i = 0; i < count; i++)
+        printf("%s%u,%s", i % 12 == 0 ? "    " : " ", sortedId[i], i % 12 == 11 || i == count - 1 ? "\n" : "");
+    if (count == 0)
+        printf("    0,\n");
+    printf("};\n\n");
+    printf("static const uint16_t libraryCellStart[%u] =\n{\n", cells + 1);
+    for (i = 0; i <= cells; i++)
+        printf("%s%u,%s", i % 12 == 0 ? "    " : " ", cellStart[i], i % 12 == 11 || i == cells ? "\n" : "");
+    printf("};\n\n");
+    printf("const struct library referenceLibrary = {libraryRgb, libraryId, libraryCellStart, %lu, %u};\n",
+           (unsigned long)count, bits);
+    return 0;
+}
@@ -0,0 +1,346 @@
+// UART0 functions
+// Interrupt-driven transmit ring buffer and command line receiver
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Writers, including ISRs, copy bytes into a ring buffer and return; the UART0
+// TX interrupt moves them into the hardware FIFO as it drains. When the buffer
+// and the FIFO are both empty a write goes straight to the FIFO, which is what
+// re-arms the interrupt.
+//
+// holdUart0Tx() lends the transmitter to someone else (the uDMA stream): bytes
+// written meanwhile stay queued, newest dropped when full, and go out when the
+// hold ends. muteUart0() discards what is written instead, for the handlers
+// that a script runs back to back.
+//
+// The RX interrupt assembles characters into lines in the background
+// (backspace, lowercasing, MAX_CHARS limit) and queues complete lines for the
+// main loop, so a host can send several commands without waiting for each one.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "hal.h"
+#include "uart0.h"
+
+#define TX_MASK (TX_BUFFER_SIZE - 1)
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+static char txBuffer[TX_BUFFER_SIZE];
+static volatile uint16_t txWrite = 0;       // next free slot
+static volatile uint16_t txRead = 0;        // oldest queued byte
+static volatile uint32_t txDropped = 0;
+static uint32_t txWritten = 0;              // bytes accepted since reset
+static uint16_t txHighWater = 0;
+static uint8_t txPolicy = TX_BLOCK;
+static volatile bool txHeld = false;        // transmitter lent out, keep bytes queued
+static bool txMuted = false;                // writes discarded, not counted as dropped
+
+static char rxLine[MAX_CHARS+1];            // line being assembled
+static uint8_t rxCount = 0;
+static bool rxAfterCr = false;              // swallow the LF of a CR LF pair
+static char rxLines[RX_LINES][MAX_CHARS+1];
+static volatile uint8_t rxLineWrite = 0;
+static volatile uint8_t rxLineRead = 0;
+static volatile uint8_t rxLinesQueued = 0;
+static volatile uint32_t rxLinesDropped = 0;
+static volatile bool anyKeyArmed = false;
+static volatile bool anyKeyHit = false;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Moves queued bytes into the hardware FIFO, call with interrupts masked
+static void fillTxFifo()
+{
+    if (txHeld)
+    {
+        disableUart0TxInt();
+        return;
+    }
+    while (txRead != txWrite && !isUart0TxFull())
+    {
+        writeUart0Tx(txBuffer[txRead]);
+        txRead = (txRead + 1) & TX_MASK;
+    }
+    if (txRead == txWrite)
+        disableUart0TxInt();                // nothing left, stop interrupting
+    else
+        enableUart0TxInt();
+}
+
+// Non-blocking unless the buffer is full and the policy is TX_BLOCK
+void putcUart0(char c)
+{
+    uint32_t state;
+    uint16_t used;
+
+    if (txMuted)
+        return;
+    state = disableInterrupts();
+    while (((txWrite + 1) & TX_MASK) == txRead)
+    {
+        if (txPolicy == TX_DROP_OLDEST)
+        {
+            txRead = (txRead + 1) & TX_MASK;
+            txDropped++;
+        }
+        else if (txPolicy == TX_DROP_NEWEST || inInterrupt() || txHeld)
+        {
+            txDropped++;
+            restoreInterrupts(state);
+            return;
+        }
+        else
+        {
+            restoreInterrupts(state);
+            waitForInterrupt();             // let the TX interrupt drain the buffer
+            state = disableInterrupts();
+        }
+    }
+
+    txBuffer[txWrite] = c;
+    txWrite = (txWrite + 1) & TX_MASK;
+    txWritten++;
+    used = (txWrite - txRead) & TX_MASK;
+    if (used > txHighWater)
+        txHighWater = used;
+    fillTxFifo();
+    restoreInterrupts(state);
+}
+
+void putsUart0(char* str)
+{
+    uint16_t i;
+    for (i = 0; str[i] != 0; i++)
+        putcUart0(str[i]);
+}
+
+// Non-blocking, copies the oldest complete line into str and returns true,
+// or returns false if no line has been entered yet
+bool getsUart0(char* str)
+{
+    uint32_t state;
+
+    if (rxLinesQueued == 0)
+        return false;
+    memcpy(str, rxLines[rxLineRead], MAX_CHARS+1);
+    state = disableInterrupts();
+    rxLineRead = (rxLineRead + 1) % RX_LINES;
+    rxLinesQueued--;
+    restoreInterrupts(state);
+    return true;
+}
+
+// True if a line or a keypress is waiting for the main loop
+bool isRxPending()
+{
+    return rxLinesQueued > 0 || anyKeyHit;
+}
+
+// The next character received is taken as a keypress instead of line input
+void armAnyKey()
+{
+    anyKeyHit = false;
+    anyKeyArmed = true;
+}
+
+bool anyKeyPressed()
+{
+    bool hit = anyKeyHit;
+    anyKeyHit = false;
+    return hit;
+}
+
+uint32_t getRxLinesDropped()
+{
+    return rxLinesDropped;
+}
+
+void setTxPolicy(uint8_t policy)
+{
+    txPolicy = policy;
+}
+
+uint8_t getTxPolicy()
+{
+    return txPolicy;
+}
+
+uint16_t getTxUsed()
+{
+    return (txWrite - txRead) & TX_MASK;
+}
+
+uint16_t getTxHighWater()
+{
+    return txHighWater;
+}
+
+uint32_t getTxDropped()
+{
+    return txDropped;
+}
+
+// Waits until everything queued has left the transmitter
+void flushUart0()
+{
+    uint32_t state;
+
+    while (getTxUsed() != 0)
+    {
+        state = disableInterrupts();        // the last TX interrupt may land before the WFI
+        if (getTxUsed() != 0)
+            waitForInterrupt();             // TX interrupt refills the FIFO
+        restoreInterrupts(state);
+    }
+    while (isUart0Busy());                  // last characters shifting out
+}
+
+// While held, nothing queued is moved to the transmitter; call flushUart0()
+// first so the holder starts with an idle UART
+void holdUart0Tx(bool hold)
+{
+    uint32_t state = disableInterrupts();
+    txHeld = hold;
+    fillTxFifo();
+    restoreInterrupts(state);
+}
+
+void muteUart0(bool mute)
+{
+    txMuted = mute;
+}
+
+static uint8_t linkPattern(uint16_t i)
+{
+    return i * 7 + 1;                       // every byte value, zero included
+}
+
+// Sends count bytes at the current rate, with interrupts masked, and checks
+// them as they come back: through the UART's internal loopback, or with echo
+// through the cable and the host, which sends back the count bytes that follow
+// a LINK_ECHO_TAG line (tools/linkecho). The loopback only shows what the
+// divisor and the CPU manage; echo also covers the adapter and the host. lost
+// is bytes that never arrived, corrupt those that arrived wrong and flagged
+// those with a receive error flag. Returns the bytes received intact.
+uint16_t runLinkTest(uint16_t count, bool echo, uint16_t* lost, uint16_t* corrupt, uint32_t* flagged,
+                     uint32_t* clocks)
+{
+    uint32_t state, start, limit, errors;
+    uint16_t sent = 0, received = 0, good = 0;
+
+    flushUart0();
+    state = disableInterrupts();
+    while (!isUart0RxEmpty())
+        readUart0Rx();                      // stale input
+    errors = getUart0RxErrors();
+    limit = 2 * (count + UART_FIFO) * (10 * (SYSTEM_CLOCK / getUart0Baud())) + SYSTEM_CLOCK / 1000;
+    if (echo)
+        limit += LINK_ECHO_WAIT_MS * (SYSTEM_CLOCK / 1000);
+    else
+        setUart0Loopback(true);
+    start = readCycleCounter();
+    while (received < count && readCycleCounter() - start < limit)
+    {
+        // stay a FIFO behind so the loopback cannot overrun RX; the host's
+        // echo comes back at the line rate however far ahead we are
+        if (sent < count && (echo || sent - received < UART_FIFO) && !isUart0TxFull())
+            writeUart0Tx(linkPattern(sent++));
+        if (!isUart0RxEmpty())
+        {
+            if ((uint8_t)readUart0Rx() == linkPattern(received))
+                good++;
+            received++;
+        }
+    }
+    *clocks = readCycleCounter() - start;
+    while (isUart0Busy());
+    if (!echo)
+        setUart0Loopback(false);
+    *flagged = getUart0RxErrors() - errors;
+    restoreInterrupts(state);
+    *lost = count - received;
+    *corrupt = received - good;
+    return good;
+}
+
+uint32_t getTxWritten()
+{
+    return txWritten;
+}
+
+static void queueLine()
+{
+    rxLine[rxCount] = '\0';                 // null terminate
+    rxCount = 0;
+    if (rxLinesQueued == RX_LINES)
+    {
+        rxLinesDropped++;
+        return;
+    }
+    memcpy(rxLines[rxLineWrite], rxLine, MAX_CHARS+1);
+    rxLineWrite = (rxLineWrite + 1) % RX_LINES;
+    rxLinesQueued++;
+}
+
+static void receive(char c)
+{
+    bool afterCr = rxAfterCr;
+    rxAfterCr = false;
+
+    if (anyKeyArmed)
+    {
+        anyKeyArmed = false;
+        anyKeyHit = true;
+        rxAfterCr = (c == 13);
+        return;
+    }
+
+    if (c == 8)                             // if c = backspace
+    {
+        if (rxCount > 0)
+            --rxCount;
+    }
+    else if (c == 13)                       // if c = enter key
+    {
+        queueLine();
+        rxAfterCr = true;
+    }
+    else if (c == 10)                       // line feed, ends a line unless it follows CR
+    {
+        if (!afterCr)
+            queueLine();
+    }
+    else
+    {
+        if (c >= 65  && c <= 90)            // if upper case letter
+            c += 32;                        // convert to lower case letter
+        rxLine[rxCount++] = c;
+        if (rxCount == (MAX_CHARS - 1))     // if max input is reached
+            queueLine();
+    }
+}
+
+// UART0 interrupt: RX FIFO reached its trigger level or timed out, or the TX FIFO
+// dropped below its trigger level
+void uart0Isr()
+{
+    clearUart0Int();
+    while (!isUart0RxEmpty())
+        receive(readUart0Rx());
+    fillTxFifo();
+}
@@ -0,0 +1,54 @@
+// UART0 functions
+// Interrupt-driven transmit ring buffer and command line receiver
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef UART0_H_
+#define UART0_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MAX_CHARS       80          // max number of chars from user input
+#define RX_LINES        4           // complete lines waiting for the main loop
+#define TX_BUFFER_SIZE  512         // bytes, must be a power of 2
+#define UART_FIFO       16          // hardware FIFO depth
+#define LINK_TEST_MAX   4096        // link test bytes
+#define LINK_ECHO_TAG   "Link echo "    // then the byte count; the host echoes that many bytes
+#define LINK_ECHO_WAIT_MS 100       // host turnaround allowed in echo mode
+
+// What a writer does when the transmit buffer is full
+#define TX_BLOCK        0           // wait for the TX interrupt to make room (ISRs drop newest)
+#define TX_DROP_NEWEST  1           // discard the byte being written
+#define TX_DROP_OLDEST  2           // discard the oldest queued byte
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void putcUart0(char c);
+void putsUart0(char* str);
+bool getsUart0(char* str);
+bool isRxPending();
+void armAnyKey();
+bool anyKeyPressed();
+uint32_t getRxLinesDropped();
+void setTxPolicy(uint8_t policy);
+uint8_t getTxPolicy();
+uint16_t getTxUsed();
+uint16_t getTxHighWater();
+uint32_t getTxDropped();
+uint32_t getTxWritten();
+void flushUart0();
+void holdUart0Tx(bool hold);
+void muteUart0(bool mute);
+uint16_t runLinkTest(uint16_t count, bool echo, uint16_t* lost, uint16_t* corrupt, uint32_t* flagged,
+                     uint32_t* clocks);
+void uart0Isr();
+
+#endif